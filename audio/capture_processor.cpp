@@ -0,0 +1,42 @@
+#include "capture_processor.h"
+
+#include <algorithm>
+
+#include "crossfade.h"
+
+void CaptureProcessor::SetNoiseSuppression(bool enable) {
+  noiseSuppression_.store(enable, std::memory_order_relaxed);
+}
+
+void CaptureProcessor::SetAutomaticGainControl(bool enable) {
+  automaticGainControl_.store(enable, std::memory_order_relaxed);
+}
+
+void CaptureProcessor::Process(float* block) {
+  bool noiseSuppression{noiseSuppression_.load(std::memory_order_relaxed)};
+
+  bypass_ = delayed_;
+  std::copy(block, block + kBlockFrames, delayed_.begin());
+  noiseSuppressor_.Process(block);
+
+  if (noiseSuppression && !noiseSuppressionActive_) {
+    Crossfade(bypass_.data(), block, kBlockFrames, 0.0f, 1.0f / kBlockFrames);
+    std::copy(bypass_.begin(), bypass_.end(), block);
+  } else if (!noiseSuppression && noiseSuppressionActive_) {
+    Crossfade(block, bypass_.data(), kBlockFrames, 0.0f, 1.0f / kBlockFrames);
+  } else if (!noiseSuppression) {
+    std::copy(bypass_.begin(), bypass_.end(), block);
+  }
+  noiseSuppressionActive_ = noiseSuppression;
+
+  // An AGC that's switched back on starts over instead of
+  // resuming from whatever state it had when it was switched off
+  bool automaticGainControl{
+      automaticGainControl_.load(std::memory_order_relaxed)};
+  if (automaticGainControl && !automaticGainControlActive_) {
+    gainControl_.Reset();
+  }
+  automaticGainControlActive_ = automaticGainControl;
+
+  if (automaticGainControl) gainControl_.Process(block, kBlockFrames);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+#include "gain_control.h"
+#include "noise_suppression.h"
+
+// The processing chain microphone audio goes through before encoding
+// Noise suppression runs first so the AGC doesn't pump up the noise floor
+// Stages are toggled from the JavaScript thread while Process runs on the
+// PipeWire data thread, so the toggles are atomics and nothing allocates
+// Noise suppression delays the audio by a block, so it keeps running while
+// switched off and the untouched audio goes through a matching delay line,
+// toggling it crossfades between the two instead of skipping or repeating
+// 10 ms of audio
+class CaptureProcessor {
+ public:
+  static constexpr size_t kSampleRate{48000};
+  static constexpr size_t kBlockFrames{NoiseSuppressor::kBlockFrames};
+
+  void SetNoiseSuppression(bool enable);
+
+  void SetAutomaticGainControl(bool enable);
+
+  // Processes one 10 ms block of 48 kHz mono audio in place
+  void Process(float* block);
+
+ private:
+  std::atomic<bool> noiseSuppression_{false};
+  std::atomic<bool> automaticGainControl_{false};
+  // Only touched by the thread calling Process
+  bool noiseSuppressionActive_{};
+  bool automaticGainControlActive_{};
+  NoiseSuppressor noiseSuppressor_;
+  std::array<float, kBlockFrames> delayed_{};
+  std::array<float, kBlockFrames> bypass_{};
+  GainControl gainControl_;
+};
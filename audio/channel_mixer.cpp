@@ -0,0 +1,98 @@
+#include "channel_mixer.h"
+
+#include <algorithm>
+#include <numbers>
+
+namespace {
+enum class Side { kLeft, kRight, kCenter, kLowFrequency };
+
+Side SideOf(ChannelPosition position) {
+  switch (position) {
+    case ChannelPosition::kFrontLeft:
+    case ChannelPosition::kSideLeft:
+    case ChannelPosition::kRearLeft:
+      return Side::kLeft;
+    case ChannelPosition::kFrontRight:
+    case ChannelPosition::kSideRight:
+    case ChannelPosition::kRearRight:
+      return Side::kRight;
+    case ChannelPosition::kLowFrequency:
+      return Side::kLowFrequency;
+    default:
+      return Side::kCenter;
+  }
+}
+
+// centerTakesSides is set when the output has nowhere else to put
+// left and right, i.e. when it's a mono (or centre only) layout
+float Coefficient(Side out, Side in, bool centerTakesSides) {
+  constexpr float kMinus3dB{std::numbers::sqrt2_v<float> / 2};
+
+  if (out == Side::kLowFrequency || in == Side::kLowFrequency) {
+    return out == in ? 1.0f : 0.0f;
+  }
+  if (out == in) return 1.0f;
+  if (in == Side::kCenter) return kMinus3dB;
+  if (out == Side::kCenter) return centerTakesSides ? 0.5f : 0.0f;
+  return 0.0f;
+}
+}  // namespace
+
+std::vector<ChannelPosition> DefaultChannelLayout(size_t channels) {
+  static constexpr ChannelPosition kSurround[]{ChannelPosition::kFrontLeft,
+                                               ChannelPosition::kFrontRight,
+                                               ChannelPosition::kFrontCenter,
+                                               ChannelPosition::kLowFrequency,
+                                               ChannelPosition::kRearLeft,
+                                               ChannelPosition::kRearRight,
+                                               ChannelPosition::kSideLeft,
+                                               ChannelPosition::kSideRight};
+
+  if (channels == 1) return {ChannelPosition::kMono};
+
+  std::vector<ChannelPosition> layout(channels, ChannelPosition::kOther);
+  for (size_t i{}; i < channels && i < std::size(kSurround); i++) {
+    layout[i] = kSurround[i];
+  }
+  return layout;
+}
+
+ChannelMixer::ChannelMixer(const std::vector<ChannelPosition>& input,
+                           const std::vector<ChannelPosition>& output)
+    : kernels_{GetDspKernels()},
+      inputs_{input.size()},
+      outputs_{output.size()},
+      matrix_(input.size() * output.size()) {
+  bool centerTakesSides{std::none_of(
+      output.begin(), output.end(), [](ChannelPosition position) {
+        Side side{SideOf(position)};
+        return side == Side::kLeft || side == Side::kRight;
+      })};
+
+  for (size_t o{}; o < outputs_; o++) {
+    float* row{matrix_.data() + o * inputs_};
+    float sum{};
+    for (size_t i{}; i < inputs_; i++) {
+      row[i] =
+          Coefficient(SideOf(output[o]), SideOf(input[i]), centerTakesSides);
+      sum += row[i];
+    }
+    if (sum > 1.0f) {
+      for (size_t i{}; i < inputs_; i++) row[i] /= sum;
+    }
+  }
+}
+
+void ChannelMixer::Process(const float* const* input,
+                           float* const* output,
+                           size_t frames) const {
+  for (size_t o{}; o < outputs_; o++) {
+    const float* row{matrix_.data() + o * inputs_};
+    std::fill(output[o], output[o] + frames, 0.0f);
+    for (size_t i{}; i < inputs_; i++) {
+      if (row[i] != 0.0f) {
+        kernels_.scale_accumulate(output[o], input[i], row[i], frames);
+      }
+    }
+  }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "dsp_kernels.h"
+
+// Speaker positions we know how to place, everything else
+// (AUX channels of pro interfaces and the like) counts as kOther
+enum class ChannelPosition {
+  kMono,
+  kFrontLeft,
+  kFrontRight,
+  kFrontCenter,
+  kLowFrequency,
+  kSideLeft,
+  kSideRight,
+  kRearLeft,
+  kRearRight,
+  kOther,
+};
+
+// Layout to assume when a device doesn't tell us its positions
+std::vector<ChannelPosition> DefaultChannelLayout(size_t channels);
+
+// Down/upmixes planar audio through a matrix built from both layouts
+// Left goes to left, right to right and centre-ish channels to both sides
+// at -3 dB; rows that would sum above unity are scaled back so a downmix
+// can't clip
+class ChannelMixer {
+ public:
+  ChannelMixer(const std::vector<ChannelPosition>& input,
+               const std::vector<ChannelPosition>& output);
+
+  size_t InputChannels() const { return inputs_; }
+
+  size_t OutputChannels() const { return outputs_; }
+
+  // input and output hold one pointer per channel, they must not overlap
+  void Process(const float* const* input,
+               float* const* output,
+               size_t frames) const;
+
+ private:
+  const dsp_kernels& kernels_;
+  size_t inputs_;
+  size_t outputs_;
+  // outputs_ rows of inputs_ coefficients
+  std::vector<float> matrix_;
+};
@@ -0,0 +1,14 @@
+#include "crossfade.h"
+
+#include "dsp_kernels.h"
+
+void Crossfade(float* from,
+               float* to,
+               size_t count,
+               float position,
+               float step) {
+  const dsp_kernels& kernels{GetDspKernels()};
+  kernels.gain_ramp(from, count, 1.0f - position, -step);
+  kernels.gain_ramp(to, count, position, step);
+  kernels.scale_accumulate(from, to, 1.0f, count);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+
+// Linear crossfade used when one device stream takes over from another
+// position is how far into the fade (0 to 1) the first sample is and step
+// how much it advances per sample
+// The result is written to from, to is used as scratch
+void Crossfade(float* from,
+               float* to,
+               size_t count,
+               float position,
+               float step);
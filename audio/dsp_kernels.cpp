@@ -0,0 +1,55 @@
+#include "dsp_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Portable fallback, one float per "register"
+namespace dsp_scalar {
+struct Vec {
+  using reg = float;
+  static constexpr size_t kWidth{1};
+  static constexpr const char* kName{"scalar"};
+
+  static reg load(const float* p) { return *p; }
+  static void store(float* p, reg a) { *p = a; }
+  static reg set1(float a) { return a; }
+  static reg iota() { return 0.0f; }
+  static reg add(reg a, reg b) { return a + b; }
+  static reg sub(reg a, reg b) { return a - b; }
+  static reg mul(reg a, reg b) { return a * b; }
+  static reg div(reg a, reg b) { return a / b; }
+  static reg mul_add(reg a, reg b, reg c) { return a * b + c; }
+  static reg min(reg a, reg b) { return std::min(a, b); }
+  static reg max(reg a, reg b) { return std::max(a, b); }
+  static reg abs(reg a) { return std::fabs(a); }
+  static float reduce_add(reg a) { return a; }
+  static float reduce_max(reg a) { return a; }
+};
+}  // namespace dsp_scalar
+
+#define DSP_KERNELS_NAMESPACE dsp_scalar
+#include "dsp_kernels_impl.h"
+#undef DSP_KERNELS_NAMESPACE
+
+#ifdef OPENVOE_X86_KERNELS
+// Defined in dsp_kernels_sse2.cpp and dsp_kernels_avx2.cpp
+const dsp_kernels& GetSse2DspKernels();
+const dsp_kernels& GetAvx2DspKernels();
+#endif
+
+static const dsp_kernels& SelectDspKernels() {
+#ifdef OPENVOE_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return GetAvx2DspKernels();
+  }
+  return GetSse2DspKernels();
+#else
+  return dsp_scalar::kKernels;
+#endif
+}
+
+const dsp_kernels& GetDspKernels() {
+  static const dsp_kernels& kernels{SelectDspKernels()};
+  return kernels;
+}
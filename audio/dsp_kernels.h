@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+
+// Table of the hot float loops used by the audio processing stages
+// Every entry exists in a scalar, SSE2 and AVX2 flavour and the best one
+// for the CPU we're running on is picked once at startup
+struct dsp_kernels {
+  // dst[i] = a[i] * b[i]
+  void (*multiply)(float* dst, const float* a, const float* b, size_t n);
+  // dst[i] = re[i] * re[i] + im[i] * im[i]
+  void (*power_spectrum)(float* dst,
+                         const float* re,
+                         const float* im,
+                         size_t n);
+  // re[i] *= gain[i], im[i] *= gain[i]
+  void (*scale_complex)(float* re, float* im, const float* gain, size_t n);
+  // Radix-2 FFT butterflies between the a and b halves of a stage
+  void (*butterfly)(float* a_re,
+                    float* a_im,
+                    float* b_re,
+                    float* b_im,
+                    const float* w_re,
+                    const float* w_im,
+                    size_t n);
+  // smoothed = alpha * smoothed + (1 - alpha) * power
+  // noise = max(min(noise * rise, smoothed), floor)
+  void (*track_noise)(float* noise,
+                      float* smoothed,
+                      const float* power,
+                      size_t n,
+                      float alpha,
+                      float rise,
+                      float floor);
+  // Decision-directed Wiener gain, gain and posterior hold the
+  // previous frame on entry and are overwritten with this frame's values
+  void (*suppression_gain)(float* gain,
+                           float* posterior,
+                           const float* power,
+                           const float* noise,
+                           size_t n,
+                           float smoothing,
+                           float floor);
+  // dst[i] += src[i] * gain
+  void (*scale_accumulate)(float* dst, const float* src, float gain, size_t n);
+  // x[i] = clamp(x[i] * (gain + i * step), -1, 1)
+  void (*gain_ramp)(float* x, size_t n, float gain, float step);
+  float (*sum_of_squares)(const float* x, size_t n);
+  float (*max_abs)(const float* x, size_t n);
+  float (*dot_product)(const float* a, const float* b, size_t n);
+  const char* name;
+};
+
+const dsp_kernels& GetDspKernels();
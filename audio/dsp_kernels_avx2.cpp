@@ -0,0 +1,52 @@
+#include "dsp_kernels.h"
+
+#include <immintrin.h>
+
+// Built with -mavx2 -mfma, only ever called after a runtime CPU check
+// so nothing in here may be reached from static initialization
+namespace dsp_avx2 {
+struct Vec {
+  using reg = __m256;
+  static constexpr size_t kWidth{8};
+  static constexpr const char* kName{"avx2"};
+
+  static reg load(const float* p) { return _mm256_loadu_ps(p); }
+  static void store(float* p, reg a) { _mm256_storeu_ps(p, a); }
+  static reg set1(float a) { return _mm256_set1_ps(a); }
+  static reg iota() {
+    return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+  }
+  static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+  static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+  static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+  static reg div(reg a, reg b) { return _mm256_div_ps(a, b); }
+  static reg mul_add(reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+  static reg min(reg a, reg b) { return _mm256_min_ps(a, b); }
+  static reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+  static reg abs(reg a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+  static float reduce_add(reg a) {
+    __m128 half{_mm_add_ps(_mm256_castps256_ps128(a),
+                           _mm256_extractf128_ps(a, 1))};
+    __m128 shuffled{_mm_movehdup_ps(half)};
+    __m128 sums{_mm_add_ps(half, shuffled)};
+    shuffled = _mm_movehl_ps(shuffled, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+  }
+  static float reduce_max(reg a) {
+    __m128 half{_mm_max_ps(_mm256_castps256_ps128(a),
+                           _mm256_extractf128_ps(a, 1))};
+    __m128 shuffled{_mm_movehdup_ps(half)};
+    __m128 maxes{_mm_max_ps(half, shuffled)};
+    shuffled = _mm_movehl_ps(shuffled, maxes);
+    return _mm_cvtss_f32(_mm_max_ss(maxes, shuffled));
+  }
+};
+}  // namespace dsp_avx2
+
+#define DSP_KERNELS_NAMESPACE dsp_avx2
+#include "dsp_kernels_impl.h"
+#undef DSP_KERNELS_NAMESPACE
+
+const dsp_kernels& GetAvx2DspKernels() {
+  return dsp_avx2::kKernels;
+}
@@ -0,0 +1,236 @@
+// Kernel bodies shared by every instruction set
+// The including file defines DSP_KERNELS_NAMESPACE and, inside that
+// namespace, a Vec type wrapping the registers of its instruction set
+// This header is meant to be included once per translation unit
+
+#ifndef DSP_KERNELS_NAMESPACE
+#error "DSP_KERNELS_NAMESPACE must be defined before including this file"
+#endif
+
+// Only plain operators in here, inline library templates like std::min
+// would be emitted by every instruction set and the linker is free to keep
+// the AVX2 copy for the scalar path
+
+namespace DSP_KERNELS_NAMESPACE {
+
+static float Min(float a, float b) {
+  return a < b ? a : b;
+}
+
+static float Max(float a, float b) {
+  return a > b ? a : b;
+}
+
+static void Multiply(float* dst, const float* a, const float* b, size_t n) {
+  size_t i{};
+  for (; i + Vec::kWidth <= n; i += Vec::kWidth) {
+    Vec::store(dst + i, Vec::mul(Vec::load(a + i), Vec::load(b + i)));
+  }
+  for (; i < n; i++) dst[i] = a[i] * b[i];
+}
+
+static void PowerSpectrum(float* dst,
+                          const float* re,
+                          const float* im,
+                          size_t n) {
+  size_t i{};
+  for (; i + Vec::kWidth <= n; i += Vec::kWidth) {
+    auto r{Vec::load(re + i)};
+    auto m{Vec::load(im + i)};
+    Vec::store(dst + i, Vec::mul_add(r, r, Vec::mul(m, m)));
+  }
+  for (; i < n; i++) dst[i] = re[i] * re[i] + im[i] * im[i];
+}
+
+static void ScaleComplex(float* re, float* im, const float* gain, size_t n) {
+  size_t i{};
+  for (; i + Vec::kWidth <= n; i += Vec::kWidth) {
+    auto g{Vec::load(gain + i)};
+    Vec::store(re + i, Vec::mul(Vec::load(re + i), g));
+    Vec::store(im + i, Vec::mul(Vec::load(im + i), g));
+  }
+  for (; i < n; i++) {
+    re[i] *= gain[i];
+    im[i] *= gain[i];
+  }
+}
+
+static void Butterfly(float* a_re,
+                      float* a_im,
+                      float* b_re,
+                      float* b_im,
+                      const float* w_re,
+                      const float* w_im,
+                      size_t n) {
+  size_t i{};
+  for (; i + Vec::kWidth <= n; i += Vec::kWidth) {
+    auto br{Vec::load(b_re + i)};
+    auto bi{Vec::load(b_im + i)};
+    auto wr{Vec::load(w_re + i)};
+    auto wi{Vec::load(w_im + i)};
+    auto tr{Vec::sub(Vec::mul(br, wr), Vec::mul(bi, wi))};
+    auto ti{Vec::mul_add(br, wi, Vec::mul(bi, wr))};
+    auto ar{Vec::load(a_re + i)};
+    auto ai{Vec::load(a_im + i)};
+    Vec::store(b_re + i, Vec::sub(ar, tr));
+    Vec::store(b_im + i, Vec::sub(ai, ti));
+    Vec::store(a_re + i, Vec::add(ar, tr));
+    Vec::store(a_im + i, Vec::add(ai, ti));
+  }
+  for (; i < n; i++) {
+    float tr{b_re[i] * w_re[i] - b_im[i] * w_im[i]};
+    float ti{b_re[i] * w_im[i] + b_im[i] * w_re[i]};
+    b_re[i] = a_re[i] - tr;
+    b_im[i] = a_im[i] - ti;
+    a_re[i] += tr;
+    a_im[i] += ti;
+  }
+}
+
+static void TrackNoise(float* noise,
+                       float* smoothed,
+                       const float* power,
+                       size_t n,
+                       float alpha,
+                       float rise,
+                       float floor) {
+  auto alphaV{Vec::set1(alpha)};
+  auto betaV{Vec::set1(1.0f - alpha)};
+  auto riseV{Vec::set1(rise)};
+  auto floorV{Vec::set1(floor)};
+  size_t i{};
+  for (; i + Vec::kWidth <= n; i += Vec::kWidth) {
+    auto s{Vec::mul_add(alphaV,
+                        Vec::load(smoothed + i),
+                        Vec::mul(betaV, Vec::load(power + i)))};
+    Vec::store(smoothed + i, s);
+    auto risen{Vec::mul(Vec::load(noise + i), riseV)};
+    Vec::store(noise + i, Vec::max(Vec::min(risen, s), floorV));
+  }
+  for (; i < n; i++) {
+    smoothed[i] = alpha * smoothed[i] + (1.0f - alpha) * power[i];
+    noise[i] = Max(Min(noise[i] * rise, smoothed[i]), floor);
+  }
+}
+
+static void SuppressionGain(float* gain,
+                            float* posterior,
+                            const float* power,
+                            const float* noise,
+                            size_t n,
+                            float smoothing,
+                            float floor) {
+  constexpr float kEpsilon{1e-12f};
+  auto oneV{Vec::set1(1.0f)};
+  auto zeroV{Vec::set1(0.0f)};
+  auto epsilonV{Vec::set1(kEpsilon)};
+  auto smoothingV{Vec::set1(smoothing)};
+  auto restV{Vec::set1(1.0f - smoothing)};
+  auto floorV{Vec::set1(floor)};
+  size_t i{};
+  for (; i + Vec::kWidth <= n; i += Vec::kWidth) {
+    auto g{Vec::load(gain + i)};
+    auto post{Vec::div(Vec::load(power + i),
+                       Vec::add(Vec::load(noise + i), epsilonV))};
+    auto previous{Vec::mul(Vec::mul(g, g), Vec::load(posterior + i))};
+    auto prior{Vec::mul_add(smoothingV,
+                            previous,
+                            Vec::mul(restV, Vec::max(Vec::sub(post, oneV),
+                                                     zeroV)))};
+    g = Vec::max(Vec::div(prior, Vec::add(prior, oneV)), floorV);
+    Vec::store(posterior + i, post);
+    Vec::store(gain + i, g);
+  }
+  for (; i < n; i++) {
+    float post{power[i] / (noise[i] + kEpsilon)};
+    float prior{smoothing * gain[i] * gain[i] * posterior[i] +
+                (1.0f - smoothing) * Max(post - 1.0f, 0.0f)};
+    posterior[i] = post;
+    gain[i] = Max(prior / (prior + 1.0f), floor);
+  }
+}
+
+static void ScaleAccumulate(float* dst,
+                            const float* src,
+                            float gain,
+                            size_t n) {
+  auto gainV{Vec::set1(gain)};
+  size_t i{};
+  for (; i + Vec::kWidth <= n; i += Vec::kWidth) {
+    Vec::store(dst + i,
+               Vec::mul_add(Vec::load(src + i), gainV, Vec::load(dst + i)));
+  }
+  for (; i < n; i++) dst[i] += src[i] * gain;
+}
+
+static void GainRamp(float* x, size_t n, float gain, float step) {
+  auto minV{Vec::set1(-1.0f)};
+  auto maxV{Vec::set1(1.0f)};
+  auto offsetV{Vec::mul(Vec::iota(), Vec::set1(step))};
+  size_t i{};
+  for (; i + Vec::kWidth <= n; i += Vec::kWidth) {
+    auto g{Vec::add(Vec::set1(gain + i * step), offsetV)};
+    auto y{Vec::mul(Vec::load(x + i), g)};
+    Vec::store(x + i, Vec::min(Vec::max(y, minV), maxV));
+  }
+  for (; i < n; i++) x[i] = Min(Max(x[i] * (gain + i * step), -1.0f), 1.0f);
+}
+
+static float SumOfSquares(const float* x, size_t n) {
+  auto acc{Vec::set1(0.0f)};
+  size_t i{};
+  for (; i + Vec::kWidth <= n; i += Vec::kWidth) {
+    auto v{Vec::load(x + i)};
+    acc = Vec::mul_add(v, v, acc);
+  }
+  float sum{Vec::reduce_add(acc)};
+  for (; i < n; i++) sum += x[i] * x[i];
+  return sum;
+}
+
+static float MaxAbs(const float* x, size_t n) {
+  auto acc{Vec::set1(0.0f)};
+  size_t i{};
+  for (; i + Vec::kWidth <= n; i += Vec::kWidth) {
+    acc = Vec::max(acc, Vec::abs(Vec::load(x + i)));
+  }
+  float peak{Vec::reduce_max(acc)};
+  for (; i < n; i++) peak = Max(peak, Max(x[i], -x[i]));
+  return peak;
+}
+
+// Two accumulators hide the latency of the multiply-add chain,
+// the resampler calls this with short filters back to back
+static float DotProduct(const float* a, const float* b, size_t n) {
+  auto acc0{Vec::set1(0.0f)};
+  auto acc1{Vec::set1(0.0f)};
+  size_t i{};
+  for (; i + 2 * Vec::kWidth <= n; i += 2 * Vec::kWidth) {
+    acc0 = Vec::mul_add(Vec::load(a + i), Vec::load(b + i), acc0);
+    acc1 = Vec::mul_add(
+        Vec::load(a + i + Vec::kWidth), Vec::load(b + i + Vec::kWidth), acc1);
+  }
+  for (; i + Vec::kWidth <= n; i += Vec::kWidth) {
+    acc0 = Vec::mul_add(Vec::load(a + i), Vec::load(b + i), acc0);
+  }
+  float sum{Vec::reduce_add(Vec::add(acc0, acc1))};
+  for (; i < n; i++) sum += a[i] * b[i];
+  return sum;
+}
+
+const dsp_kernels kKernels{
+    .multiply = Multiply,
+    .power_spectrum = PowerSpectrum,
+    .scale_complex = ScaleComplex,
+    .butterfly = Butterfly,
+    .track_noise = TrackNoise,
+    .suppression_gain = SuppressionGain,
+    .scale_accumulate = ScaleAccumulate,
+    .gain_ramp = GainRamp,
+    .sum_of_squares = SumOfSquares,
+    .max_abs = MaxAbs,
+    .dot_product = DotProduct,
+    .name = Vec::kName,
+};
+
+}  // namespace DSP_KERNELS_NAMESPACE
@@ -0,0 +1,47 @@
+#include "dsp_kernels.h"
+
+#include <emmintrin.h>
+
+// Baseline for every x86_64 CPU, four floats per register
+namespace dsp_sse2 {
+struct Vec {
+  using reg = __m128;
+  static constexpr size_t kWidth{4};
+  static constexpr const char* kName{"sse2"};
+
+  static reg load(const float* p) { return _mm_loadu_ps(p); }
+  static void store(float* p, reg a) { _mm_storeu_ps(p, a); }
+  static reg set1(float a) { return _mm_set1_ps(a); }
+  static reg iota() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+  static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+  static reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+  static reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+  static reg div(reg a, reg b) { return _mm_div_ps(a, b); }
+  static reg mul_add(reg a, reg b, reg c) {
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+  }
+  static reg min(reg a, reg b) { return _mm_min_ps(a, b); }
+  static reg max(reg a, reg b) { return _mm_max_ps(a, b); }
+  static reg abs(reg a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+  static float reduce_add(reg a) {
+    reg shuffled{_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1))};
+    reg sums{_mm_add_ps(a, shuffled)};
+    shuffled = _mm_movehl_ps(shuffled, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+  }
+  static float reduce_max(reg a) {
+    reg shuffled{_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1))};
+    reg maxes{_mm_max_ps(a, shuffled)};
+    shuffled = _mm_movehl_ps(shuffled, maxes);
+    return _mm_cvtss_f32(_mm_max_ss(maxes, shuffled));
+  }
+};
+}  // namespace dsp_sse2
+
+#define DSP_KERNELS_NAMESPACE dsp_sse2
+#include "dsp_kernels_impl.h"
+#undef DSP_KERNELS_NAMESPACE
+
+const dsp_kernels& GetSse2DspKernels() {
+  return dsp_sse2::kKernels;
+}
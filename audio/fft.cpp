@@ -0,0 +1,61 @@
+#include "fft.h"
+
+#include <cmath>
+#include <numbers>
+#include <utility>
+
+Fft::Fft(size_t size)
+    : size_{size},
+      bitReverse_(size),
+      twiddleRe_(size - 1),
+      twiddleIm_(size - 1),
+      kernels_{GetDspKernels()} {
+  uint32_t bits{};
+  while ((size_t{1} << bits) < size_) bits++;
+
+  for (uint32_t i{}; i < size_; i++) {
+    uint32_t reversed{};
+    for (uint32_t b{}; b < bits; b++) {
+      reversed |= ((i >> b) & 1) << (bits - 1 - b);
+    }
+    bitReverse_[i] = reversed;
+  }
+
+  for (size_t half{1}; half < size_; half <<= 1) {
+    for (size_t j{}; j < half; j++) {
+      double angle{-std::numbers::pi * j / half};
+      twiddleRe_[half - 1 + j] = static_cast<float>(std::cos(angle));
+      twiddleIm_[half - 1 + j] = static_cast<float>(std::sin(angle));
+    }
+  }
+}
+
+void Fft::Forward(float* re, float* im) const {
+  for (uint32_t i{}; i < size_; i++) {
+    uint32_t j{bitReverse_[i]};
+    if (i < j) {
+      std::swap(re[i], re[j]);
+      std::swap(im[i], im[j]);
+    }
+  }
+
+  for (size_t half{1}; half < size_; half <<= 1) {
+    const float* wRe{twiddleRe_.data() + half - 1};
+    const float* wIm{twiddleIm_.data() + half - 1};
+    for (size_t start{}; start < size_; start += 2 * half) {
+      kernels_.butterfly(re + start,
+                         im + start,
+                         re + start + half,
+                         im + start + half,
+                         wRe,
+                         wIm,
+                         half);
+    }
+  }
+}
+
+// Swapping the real and imaginary parts on the way in and out
+// turns the forward transform into the inverse one
+void Fft::Inverse(float* re, float* im) const {
+  Forward(im, re);
+}
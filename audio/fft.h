@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dsp_kernels.h"
+
+// In-place radix-2 complex FFT on split real/imaginary arrays
+// All tables are built by the constructor so transforms never allocate
+class Fft {
+ public:
+  // size has to be a power of two
+  explicit Fft(size_t size);
+
+  size_t Size() const { return size_; }
+
+  void Forward(float* re, float* im) const;
+
+  // Unscaled, the caller has to multiply the result by 1 / Size()
+  void Inverse(float* re, float* im) const;
+
+ private:
+  size_t size_;
+  std::vector<uint32_t> bitReverse_;
+  // Twiddles of every stage back to back, the stage with
+  // half-length h starts at index h - 1
+  std::vector<float> twiddleRe_;
+  std::vector<float> twiddleIm_;
+  const dsp_kernels& kernels_;
+};
@@ -0,0 +1,82 @@
+#include "format_converter.h"
+
+#include <algorithm>
+
+FormatConverter::FormatConverter(
+    uint32_t inputRate,
+    const std::vector<ChannelPosition>& inputLayout,
+    uint32_t outputRate,
+    const std::vector<ChannelPosition>& outputLayout,
+    size_t maxInputFrames)
+    : mixer_{inputLayout, outputLayout},
+      mixFirst_{outputLayout.size() < inputLayout.size()},
+      maxInputFrames_{maxInputFrames} {
+  size_t resampled{mixFirst_ ? outputLayout.size() : inputLayout.size()};
+  resamplers_.reserve(resampled);
+  for (size_t c{}; c < resampled; c++) {
+    resamplers_.emplace_back(inputRate, outputRate, maxInputFrames);
+  }
+
+  maxOutputFrames_ = resamplers_.empty()
+                         ? maxInputFrames
+                         : resamplers_.front().MaxOutputFrames(maxInputFrames);
+  stride_ = std::max(maxInputFrames_, maxOutputFrames_);
+
+  planarInput_.resize(inputLayout.size() * stride_);
+  planarMiddle_.resize(resampled * stride_);
+  planarOutput_.resize(outputLayout.size() * stride_);
+  mixerInput_.resize(inputLayout.size());
+  mixerOutput_.resize(outputLayout.size());
+}
+
+void FormatConverter::Reset() {
+  for (auto& resampler : resamplers_) resampler.Reset();
+}
+
+size_t FormatConverter::Process(const float* input,
+                                size_t frames,
+                                float* output) {
+  const size_t inputs{InputChannels()};
+  const size_t outputs{OutputChannels()};
+  frames = std::min(frames, maxInputFrames_);
+
+  for (size_t c{}; c < inputs; c++) {
+    float* planar{planarInput_.data() + c * stride_};
+    for (size_t i{}; i < frames; i++) planar[i] = input[i * inputs + c];
+  }
+
+  size_t produced{};
+  if (mixFirst_) {
+    for (size_t c{}; c < inputs; c++) {
+      mixerInput_[c] = planarInput_.data() + c * stride_;
+    }
+    for (size_t c{}; c < outputs; c++) {
+      mixerOutput_[c] = planarMiddle_.data() + c * stride_;
+    }
+    mixer_.Process(mixerInput_.data(), mixerOutput_.data(), frames);
+
+    for (size_t c{}; c < outputs; c++) {
+      produced = resamplers_[c].Process(planarMiddle_.data() + c * stride_,
+                                        frames,
+                                        planarOutput_.data() + c * stride_);
+    }
+  } else {
+    for (size_t c{}; c < inputs; c++) {
+      produced = resamplers_[c].Process(planarInput_.data() + c * stride_,
+                                        frames,
+                                        planarMiddle_.data() + c * stride_);
+      mixerInput_[c] = planarMiddle_.data() + c * stride_;
+    }
+    for (size_t c{}; c < outputs; c++) {
+      mixerOutput_[c] = planarOutput_.data() + c * stride_;
+    }
+    mixer_.Process(mixerInput_.data(), mixerOutput_.data(), produced);
+  }
+
+  for (size_t c{}; c < outputs; c++) {
+    const float* planar{planarOutput_.data() + c * stride_};
+    for (size_t i{}; i < produced; i++) output[i * outputs + c] = planar[i];
+  }
+
+  return produced;
+}
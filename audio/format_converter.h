@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "channel_mixer.h"
+#include "resampler.h"
+
+// Converts interleaved float audio between two rates and channel layouts,
+// used between the formats devices are opened with and the 48 kHz engine
+// Remixing happens on whichever side has fewer channels so the resampler
+// does as little work as possible
+// Every buffer is sized by the constructor
+class FormatConverter {
+ public:
+  FormatConverter(uint32_t inputRate,
+                  const std::vector<ChannelPosition>& inputLayout,
+                  uint32_t outputRate,
+                  const std::vector<ChannelPosition>& outputLayout,
+                  size_t maxInputFrames);
+
+  size_t MaxInputFrames() const { return maxInputFrames_; }
+
+  size_t MaxOutputFrames() const { return maxOutputFrames_; }
+
+  size_t InputChannels() const { return mixer_.InputChannels(); }
+
+  size_t OutputChannels() const { return mixer_.OutputChannels(); }
+
+  // Converts at most MaxInputFrames() frames and returns how many frames
+  // were written, output has to hold MaxOutputFrames() frames
+  size_t Process(const float* input, size_t frames, float* output);
+
+  void Reset();
+
+ private:
+  ChannelMixer mixer_;
+  std::vector<Resampler> resamplers_;
+  bool mixFirst_;
+  size_t maxInputFrames_;
+  size_t maxOutputFrames_;
+  size_t stride_;
+  // Planar scratch, stride_ samples per channel
+  std::vector<float> planarInput_;
+  std::vector<float> planarMiddle_;
+  std::vector<float> planarOutput_;
+  std::vector<const float*> mixerInput_;
+  std::vector<float*> mixerOutput_;
+};
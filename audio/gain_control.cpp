@@ -0,0 +1,61 @@
+#include "gain_control.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// -20 dBFS RMS, as power
+constexpr float kTargetPower{0.01f};
+// Blocks under -50 dBFS RMS are treated as silence and don't move the level
+constexpr float kGatePower{1e-5f};
+// Level follower coefficients for rising and falling input
+constexpr float kLevelAttack{0.3f};
+constexpr float kLevelRelease{0.05f};
+// Gain limits, -6 dB to +30 dB
+constexpr float kMinGain{0.5f};
+constexpr float kMaxGain{31.6f};
+// Largest gain change per block, +0.1 dB up and -2 dB down
+constexpr float kMaxIncrease{1.0116f};
+constexpr float kMaxDecrease{0.7943f};
+// Peaks are held under -1 dBFS
+constexpr float kCeiling{0.891f};
+}  // namespace
+
+GainControl::GainControl() : kernels_{GetDspKernels()} {}
+
+void GainControl::Reset() {
+  gain_ = 1.0f;
+  level_ = 0.0f;
+}
+
+void GainControl::Process(float* samples, size_t count) {
+  if (count == 0) return;
+
+  float power{kernels_.sum_of_squares(samples, count) / count};
+  if (power > kGatePower) {
+    if (level_ == 0.0f) {
+      level_ = power;
+    } else {
+      float coefficient{power > level_ ? kLevelAttack : kLevelRelease};
+      level_ += coefficient * (power - level_);
+    }
+  }
+
+  float target{gain_};
+  if (level_ > 0.0f) {
+    target = std::clamp(std::sqrt(kTargetPower / level_), kMinGain, kMaxGain);
+  }
+  target = std::clamp(target, gain_ * kMaxDecrease, gain_ * kMaxIncrease);
+
+  // A ramp starting from a gain that's already too high would clip the
+  // start of the block, so the limiter drops the gain right away
+  // Both ends of the ramp then stay under the ceiling, and so does every
+  // sample in between
+  float peak{kernels_.max_abs(samples, count)};
+  if (peak * gain_ > kCeiling) gain_ = kCeiling / peak;
+  if (peak * target > kCeiling) target = kCeiling / peak;
+
+  // Ramp across the block so gain changes don't click
+  kernels_.gain_ramp(samples, count, gain_, (target - gain_) / count);
+  gain_ = target;
+}
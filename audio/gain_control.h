@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+#include "dsp_kernels.h"
+
+// Automatic gain control for the microphone
+// Follows the level of blocks louder than a noise gate and steers the gain
+// towards a fixed speech level, rising slowly and backing off quickly
+// A peak limiter keeps the boosted signal from clipping
+class GainControl {
+ public:
+  GainControl();
+
+  // Levels count samples in place
+  void Process(float* samples, size_t count);
+
+  void Reset();
+
+ private:
+  const dsp_kernels& kernels_;
+  float gain_{1.0f};
+  float level_{};
+};
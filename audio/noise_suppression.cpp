@@ -0,0 +1,109 @@
+#include "noise_suppression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace {
+// How much of the previous frame's power is kept in the smoothed spectrum
+constexpr float kPowerSmoothing{0.8f};
+// Per-frame growth of the noise floor, about 2 dB per second
+constexpr float kNoiseRise{1.0046f};
+// Lowest noise floor a bin is tracked down to, roughly the per-bin power of
+// -90 dBFS white noise
+// The floor only grows by multiplying, so without it a stretch of digital
+// silence would pin it at zero and switch suppression off for good
+constexpr float kMinNoise{1e-6f};
+// Weight of the previous frame in the a priori SNR estimate
+constexpr float kDecisionDirected{0.96f};
+// Never attenuate a bin by more than 20 dB, lower floors sound "musical"
+constexpr float kGainFloor{0.1f};
+}  // namespace
+
+NoiseSuppressor::NoiseSuppressor()
+    : kernels_{GetDspKernels()}, fft_{kFftSize} {
+  // Square root of a periodic Hann window on both sides so that
+  // analysis times synthesis sums to one at 50% overlap
+  // The synthesis side also carries the inverse FFT scaling
+  for (size_t i{}; i < kWindowFrames; i++) {
+    float hann{0.5f - 0.5f * static_cast<float>(std::cos(
+                                2.0 * std::numbers::pi * i / kWindowFrames))};
+    analysisWindow_[i] = std::sqrt(hann);
+    synthesisWindow_[i] = analysisWindow_[i] / kFftSize;
+  }
+
+  Reset();
+}
+
+void NoiseSuppressor::Reset() {
+  history_.fill(0.0f);
+  overlap_.fill(0.0f);
+  smoothedPower_.fill(0.0f);
+  noise_.fill(kMinNoise);
+  gain_.fill(1.0f);
+  posterior_.fill(1.0f);
+  primed_ = false;
+}
+
+void NoiseSuppressor::Process(float* block) {
+  std::copy(history_.begin() + kBlockFrames, history_.end(), history_.begin());
+  std::copy(block, block + kBlockFrames, history_.begin() + kBlockFrames);
+
+  kernels_.multiply(
+      re_.data(), history_.data(), analysisWindow_.data(), kWindowFrames);
+  std::fill(re_.begin() + kWindowFrames, re_.end(), 0.0f);
+  im_.fill(0.0f);
+
+  fft_.Forward(re_.data(), im_.data());
+
+  kernels_.power_spectrum(power_.data(), re_.data(), im_.data(), kBins);
+
+  // Assume the call starts with background noise rather than speech
+  // Digital silence (streams often start with it, muted mics produce it)
+  // says nothing about the noise, so the floor is learnt again from the
+  // first frame after it instead of crawling up from the bottom
+  bool silent{std::none_of(power_.begin(), power_.end(), [](float power) {
+    return power > kMinNoise;
+  })};
+  if (silent) {
+    primed_ = false;
+  } else if (!primed_) {
+    smoothedPower_ = power_;
+    for (size_t i{}; i < kBins; i++) noise_[i] = std::max(power_[i], kMinNoise);
+    primed_ = true;
+  }
+
+  kernels_.track_noise(noise_.data(),
+                       smoothedPower_.data(),
+                       power_.data(),
+                       kBins,
+                       kPowerSmoothing,
+                       kNoiseRise,
+                       kMinNoise);
+  kernels_.suppression_gain(gain_.data(),
+                            posterior_.data(),
+                            power_.data(),
+                            noise_.data(),
+                            kBins,
+                            kDecisionDirected,
+                            kGainFloor);
+
+  // The input is real so the upper half of the spectrum mirrors the lower
+  std::copy(gain_.begin(), gain_.end(), spectrumGain_.begin());
+  std::reverse_copy(gain_.begin() + 1,
+                    gain_.end() - 1,
+                    spectrumGain_.begin() + kBins);
+  kernels_.scale_complex(
+      re_.data(), im_.data(), spectrumGain_.data(), kFftSize);
+
+  fft_.Inverse(re_.data(), im_.data());
+
+  kernels_.multiply(
+      re_.data(), re_.data(), synthesisWindow_.data(), kWindowFrames);
+  for (size_t i{}; i < kBlockFrames; i++) {
+    block[i] = overlap_[i] + re_[i];
+  }
+  std::copy(re_.begin() + kBlockFrames,
+            re_.begin() + kWindowFrames,
+            overlap_.begin());
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "dsp_kernels.h"
+#include "fft.h"
+
+// Spectral noise suppressor for 48 kHz mono audio
+// Tracks the noise floor of every frequency bin with a rising minimum
+// and attenuates bins with a decision-directed Wiener gain
+// Works on 10 ms blocks with 50% overlapping windows,
+// which adds one block of latency
+class NoiseSuppressor {
+ public:
+  static constexpr size_t kBlockFrames{480};
+  static constexpr size_t kWindowFrames{2 * kBlockFrames};
+  static constexpr size_t kFftSize{1024};
+  static constexpr size_t kBins{kFftSize / 2 + 1};
+
+  NoiseSuppressor();
+
+  // Denoises kBlockFrames samples in place
+  void Process(float* block);
+
+  // Forgets the learnt noise floor and the overlap history
+  void Reset();
+
+ private:
+  const dsp_kernels& kernels_;
+  Fft fft_;
+  std::array<float, kWindowFrames> analysisWindow_;
+  std::array<float, kWindowFrames> synthesisWindow_;
+  std::array<float, kWindowFrames> history_;
+  std::array<float, kBlockFrames> overlap_;
+  std::array<float, kFftSize> re_;
+  std::array<float, kFftSize> im_;
+  std::array<float, kFftSize> spectrumGain_;
+  std::array<float, kBins> power_;
+  std::array<float, kBins> smoothedPower_;
+  std::array<float, kBins> noise_;
+  std::array<float, kBins> gain_;
+  std::array<float, kBins> posterior_;
+  bool primed_{};
+};
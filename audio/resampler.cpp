@@ -0,0 +1,124 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <numbers>
+
+namespace {
+// Filter length per phase when upsampling, multiplied by the
+// ratio when downsampling so the transition band stays put
+constexpr size_t kBaseTaps{48};
+// Fraction of the lower Nyquist frequency that's kept
+constexpr double kPassband{0.92};
+// Roughly 80 dB of stopband attenuation
+constexpr double kKaiserBeta{8.0};
+
+// Zeroth order modified Bessel function of the first kind
+double BesselI0(double x) {
+  double sum{1.0};
+  double term{1.0};
+  for (int k{1}; k < 32; k++) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+  }
+  return sum;
+}
+}  // namespace
+
+Resampler::Resampler(uint32_t inputRate,
+                     uint32_t outputRate,
+                     size_t maxInputFrames)
+    : kernels_{GetDspKernels()} {
+  uint32_t divisor{std::gcd(inputRate, outputRate)};
+  interpolation_ = outputRate / divisor;
+  decimation_ = inputRate / divisor;
+
+  if (interpolation_ == decimation_) {
+    taps_ = 1;
+    bank_.assign(1, 1.0f);
+  } else {
+    taps_ = kBaseTaps * std::max<size_t>(
+                            1,
+                            (decimation_ + interpolation_ - 1) /
+                                interpolation_);
+    size_t length{taps_ * interpolation_};
+    double cutoff{kPassband * 0.5 *
+                  std::min(1.0, double(interpolation_) / decimation_) /
+                  interpolation_};
+    double center{(length - 1) / 2.0};
+    double beta{BesselI0(kKaiserBeta)};
+
+    std::vector<double> prototype(length);
+    for (size_t k{}; k < length; k++) {
+      double x{k - center};
+      double sinc{x == 0.0 ? 2.0 * cutoff
+                           : std::sin(2.0 * std::numbers::pi * cutoff * x) /
+                                 (std::numbers::pi * x)};
+      double ratio{x / (center + 1.0)};
+      double window{BesselI0(kKaiserBeta * std::sqrt(1.0 - ratio * ratio)) /
+                    beta};
+      prototype[k] = sinc * window;
+    }
+
+    // Normalized as a whole to a DC gain of interpolation_, which makes up
+    // for the gain lost to zero stuffing
+    // Normalizing every phase on its own would flatten DC but leave each
+    // phase with its own passband ripple, heard as phase dependent noise
+    bank_.resize(length);
+    double total{};
+    for (double c : prototype) total += c;
+    for (uint32_t p{}; p < interpolation_; p++) {
+      double sum{total / interpolation_};
+      for (size_t t{}; t < taps_; t++) {
+        bank_[p * taps_ + taps_ - 1 - t] =
+            static_cast<float>(prototype[t * interpolation_ + p] / sum);
+      }
+    }
+  }
+
+  history_.resize(taps_ - 1 + maxInputFrames);
+  Reset();
+}
+
+void Resampler::Reset() {
+  // Start on a window of silence so the first input sample
+  // comes out after Latency() samples rather than being dropped
+  std::fill(history_.begin(), history_.end(), 0.0f);
+  buffered_ = taps_ - 1;
+  start_ = 0;
+  phase_ = 0;
+}
+
+size_t Resampler::MaxOutputFrames(size_t inputFrames) const {
+  return inputFrames * interpolation_ / decimation_ + 2;
+}
+
+size_t Resampler::Process(const float* input, size_t frames, float* output) {
+  if (taps_ == 1) {
+    std::copy(input, input + frames, output);
+    return frames;
+  }
+
+  std::copy(input, input + frames, history_.begin() + buffered_);
+  buffered_ += frames;
+
+  size_t produced{};
+  while (start_ + taps_ <= buffered_) {
+    output[produced++] = kernels_.dot_product(
+        history_.data() + start_, bank_.data() + phase_ * taps_, taps_);
+    phase_ += decimation_;
+    start_ += phase_ / interpolation_;
+    phase_ %= interpolation_;
+  }
+
+  // Drop what no future window can reach anymore
+  size_t consumed{std::min(start_, buffered_)};
+  std::copy(history_.begin() + consumed,
+            history_.begin() + buffered_,
+            history_.begin());
+  buffered_ -= consumed;
+  start_ -= consumed;
+
+  return produced;
+}
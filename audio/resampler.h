@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dsp_kernels.h"
+
+// Polyphase sample-rate converter for one channel
+// The rate ratio is reduced to interpolation / decimation factors and a
+// Kaiser windowed sinc is split into one short filter per phase up front,
+// so every output sample is a single dot product
+// The filters are short on purpose, the delay stays under half a millisecond
+// for upsampling and scales with the ratio when downsampling
+class Resampler {
+ public:
+  // A single Process call may be given at most maxInputFrames samples
+  Resampler(uint32_t inputRate, uint32_t outputRate, size_t maxInputFrames);
+
+  // Consumes all of input and returns how many samples were written
+  // output has to hold MaxOutputFrames(frames) samples
+  size_t Process(const float* input, size_t frames, float* output);
+
+  size_t MaxOutputFrames(size_t inputFrames) const;
+
+  // Group delay, in input samples, the centre of the prototype filter
+  // which runs at interpolation_ times the input rate
+  double Latency() const {
+    return (taps_ * interpolation_ - 1) / (2.0 * interpolation_);
+  }
+
+  void Reset();
+
+ private:
+  const dsp_kernels& kernels_;
+  uint32_t interpolation_;
+  uint32_t decimation_;
+  size_t taps_;
+  // taps_ coefficients per phase, stored back to front so they line up
+  // with the oldest-first history window
+  std::vector<float> bank_;
+  std::vector<float> history_;
+  size_t buffered_{};
+  size_t start_{};
+  uint32_t phase_{};
+};
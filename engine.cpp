@@ -1,9 +1,15 @@
 #include <arpa/inet.h>
+#include <audio_capture.h>
+#include <audio_playback.h>
 #include <bits/stdc++.h>
+#include <capture_processor.h>
+#include <connection.h>
 #include <device_change.h>
 #include <napi.h>
 #include <netinet/tcp.h>
 #include <poll.h>
+#include <rtp_recording.h>
+#include <work_pool.h>
 
 std::thread pipewireThread;
 Napi::ThreadSafeFunction tsfn;
@@ -18,6 +24,23 @@ callback_executor executor;
 
 bool aecDump{false};
 
+// Noise suppression and AGC applied to every captured block
+CaptureProcessor captureProcessor;
+
+void ProcessCaptureBlock(float* block, void* data) {
+  static_cast<CaptureProcessor*>(data)->Process(block);
+}
+
+capture_block_handler captureHandler{ProcessCaptureBlock, &captureProcessor};
+
+// Incoming RTP is written here while a recording path is set,
+// discord_voice_replay plays such recordings back
+RtpRecorder rtpRecorder;
+
+// Voice connections keep the microphone and speakers open
+// Only touched on the JavaScript thread
+int voiceConnections{};
+
 // JSON.stringify imported from the JavaScript engine
 // Will accept an Object and convert it to a string
 std::string JsonStringify(Napi::Object input, Napi::Env env) {
@@ -28,6 +51,20 @@ std::string JsonStringify(Napi::Object input, Napi::Env env) {
   return jsonString;
 }
 
+// Both initialize and setTransportOptions may carry the audio processing
+// toggles, keys that aren't present leave the current setting alone
+void ApplyAudioProcessingOptions(Napi::Object options) {
+  if (options.Has("noiseSuppression")) {
+    captureProcessor.SetNoiseSuppression(
+        options.Get("noiseSuppression").ToBoolean().Value());
+  }
+
+  if (options.Has("automaticGainControl")) {
+    captureProcessor.SetAutomaticGainControl(
+        options.Get("automaticGainControl").ToBoolean().Value());
+  }
+}
+
 // Called by index.js in order to start the main loop
 // which polls for devices etc., also gets provided with some options
 void Initialize(const Napi::CallbackInfo& info) {
@@ -49,6 +86,9 @@ void Initialize(const Napi::CallbackInfo& info) {
 
   std::cout << JsonStringify(options, env) << std::endl;
 
+  ApplyAudioProcessingOptions(options);
+  SetCaptureBlockHandler(&captureHandler);
+
   pipewireThread = std::thread{DeviceChange};
 }
 
@@ -76,6 +116,8 @@ void SetOnVoiceCallback(const Napi::CallbackInfo& info) {
 // Tells us which codecs are supported (h264, h265, av1)
 // Also gets called with a different array to tell us
 // to duck and/or flush the idle jitter buffer (WebRTC)
+// and to toggle noise suppression and automatic gain control
+// or to start and stop recording incoming RTP
 void SetTransportOptions(const Napi::CallbackInfo& info) {
   Napi::Env env{info.Env()};
 
@@ -92,6 +134,18 @@ void SetTransportOptions(const Napi::CallbackInfo& info) {
   }
 
   Napi::Object options{info[0].As<Napi::Object>()};
+
+  ApplyAudioProcessingOptions(options);
+
+  // An empty path stops recording
+  if (options.Has("rtpRecordingPath")) {
+    std::string path{options.Get("rtpRecordingPath").ToString().Utf8Value()};
+    if (path.empty()) {
+      rtpRecorder.Close();
+    } else if (int result{rtpRecorder.Open(path)}; result < 0) {
+      fprintf(stderr, "rtp recording: %s\n", strerror(-result));
+    }
+  }
 }
 
 void ExecuteCallback(void* data) {
@@ -112,7 +166,7 @@ void ExecuteCallback(void* data) {
              i++, curr++) {
           Napi::Object audioInputDevice{Napi::Object::New(env)};
           audioInputDevice.Set("name", curr->description);
-          audioInputDevice.Set("guid", "");
+          audioInputDevice.Set("guid", curr->name);
           audioInputDevice.Set("index", i);
           audioInputDevicesArray[i] = audioInputDevice;
         }
@@ -123,7 +177,7 @@ void ExecuteCallback(void* data) {
              i++, curr++) {
           Napi::Object audioOutputDevice{Napi::Object::New(env)};
           audioOutputDevice.Set("name", curr->description);
-          audioOutputDevice.Set("guid", "");
+          audioOutputDevice.Set("guid", curr->name);
           audioOutputDevice.Set("index", i);
           audioOutputDevicesArray[i] = audioOutputDevice;
         }
@@ -205,7 +259,7 @@ void GetOutputDevices(const Napi::CallbackInfo& info) {
        i++, curr++) {
     Napi::Object audioOutputDevice{Napi::Object::New(env)};
     audioOutputDevice.Set("name", curr->description);
-    audioOutputDevice.Set("guid", "");
+    audioOutputDevice.Set("guid", curr->name);
     audioOutputDevice.Set("index", i);
     audioOutputDevicesArray[i] = audioOutputDevice;
   }
@@ -239,7 +293,7 @@ void GetInputDevices(const Napi::CallbackInfo& info) {
        i++, curr++) {
     Napi::Object audioInputDevice{Napi::Object::New(env)};
     audioInputDevice.Set("name", curr->description);
-    audioInputDevice.Set("guid", "");
+    audioInputDevice.Set("guid", curr->name);
     audioInputDevice.Set("index", i);
     audioInputDevicesArray[i] = audioInputDevice;
   }
@@ -282,6 +336,45 @@ void GetVideoInputDevices(const Napi::CallbackInfo& info) {
   deviceCallback.Call(env.Global(), {videoInputDevicesArray});
 }
 
+// Both get the guid of a device we reported through the getters,
+// an empty string selects the system default
+// A running stream moves over to the new device in the background
+void SetInputDevice(const Napi::CallbackInfo& info) {
+  Napi::Env env{info.Env()};
+
+  if (info.Length() != 1) {
+    Napi::TypeError::New(env, "Wrong number of arguments, 1 expected")
+        .ThrowAsJavaScriptException();
+    return;
+  }
+
+  if (!info[0].IsString()) {
+    Napi::TypeError::New(env, "Wrong argument type, String expected")
+        .ThrowAsJavaScriptException();
+    return;
+  }
+
+  SetAudioCaptureDevice(info[0].As<Napi::String>().Utf8Value());
+}
+
+void SetOutputDevice(const Napi::CallbackInfo& info) {
+  Napi::Env env{info.Env()};
+
+  if (info.Length() != 1) {
+    Napi::TypeError::New(env, "Wrong number of arguments, 1 expected")
+        .ThrowAsJavaScriptException();
+    return;
+  }
+
+  if (!info[0].IsString()) {
+    Napi::TypeError::New(env, "Wrong argument type, String expected")
+        .ThrowAsJavaScriptException();
+    return;
+  }
+
+  SetAudioPlaybackDevice(info[0].As<Napi::String>().Utf8Value());
+}
+
 // Called by index.js, its purpose is to store
 // the allocator callback that will be used at a later phase
 void SetImageDataAllocator(const Napi::CallbackInfo& info) {
@@ -539,6 +632,248 @@ void RankRtcRegions(const Napi::CallbackInfo& info) {
   rankRtcRegionsCallback.Call(env.Global(), {rankedRegions});
 }
 
+// Every connection shares one pool with a worker per core and a single
+// thread polling all of their sockets, instead of threads of its own
+// Both are only created once the first connection is
+SocketPoller& GetSocketPoller() {
+  static WorkPool workPool{0};
+  static SocketPoller socketPoller{workPool};
+  return socketPoller;
+}
+
+void AcquireAudioDevices() {
+  if (voiceConnections++ > 0) {
+    return;
+  }
+
+  if (int result{StartAudioCapture()}; result < 0) {
+    fprintf(stderr, "audio capture: %s\n", strerror(-result));
+  }
+  if (int result{StartAudioPlayback()}; result < 0) {
+    fprintf(stderr, "audio playback: %s\n", strerror(-result));
+  }
+}
+
+void ReleaseAudioDevices() {
+  if (--voiceConnections > 0) {
+    return;
+  }
+
+  StopAudioCapture();
+  StopAudioPlayback();
+}
+
+// The object handed to JavaScript for every voice or Go Live connection
+// Any number of them can be open at once
+class ConnectionWrap : public Napi::ObjectWrap<ConnectionWrap> {
+ public:
+  static Napi::Function Define(Napi::Env env) {
+    return DefineClass(env,
+                       "Connection",
+                       {InstanceMethod("destroy", &ConnectionWrap::Destroy),
+                        InstanceMethod("getStats", &ConnectionWrap::GetStats)});
+  }
+
+  ConnectionWrap(const Napi::CallbackInfo& info)
+      : Napi::ObjectWrap<ConnectionWrap>(info) {}
+
+  ~ConnectionWrap() { Close(); }
+
+  // clockRates pairs payload types with their RTP clock rate
+  // Returns 0 on success or a negative errno
+  int Open(ConnectionKind kind,
+           const std::string& address,
+           uint16_t port,
+           const std::vector<std::pair<uint8_t, uint32_t>>& clockRates) {
+    connection_ =
+        std::make_unique<Connection>(kind, GetSocketPoller(), &rtpRecorder);
+    for (auto [payloadType, clockRate] : clockRates) {
+      connection_->SetClockRate(payloadType, clockRate);
+    }
+
+    // The audio devices are only opened for a connection that got through
+    if (int result{connection_->Connect(address, port)}; result < 0) {
+      connection_.reset();
+      return result;
+    }
+    if (kind == ConnectionKind::kVoice) {
+      AcquireAudioDevices();
+    }
+    return 0;
+  }
+
+  Napi::Object TransportInfo(Napi::Env env) {
+    Napi::Object transportInfo{Napi::Object::New(env)};
+    std::string address;
+    uint16_t port{};
+    connection_->LocalAddress(address, port);
+    transportInfo.Set("protocol", "udp");
+    transportInfo.Set("address", address);
+    transportInfo.Set("port", port);
+    return transportInfo;
+  }
+
+ private:
+  void Close() {
+    if (!connection_) {
+      return;
+    }
+
+    bool voice{connection_->Kind() == ConnectionKind::kVoice};
+    connection_.reset();
+    if (voice) {
+      ReleaseAudioDevices();
+    }
+  }
+
+  void Destroy(const Napi::CallbackInfo&) { Close(); }
+
+  void GetStats(const Napi::CallbackInfo& info) {
+    Napi::Env env{info.Env()};
+
+    if (info.Length() != 1) {
+      Napi::TypeError::New(env, "Wrong number of arguments, 1 expected")
+          .ThrowAsJavaScriptException();
+      return;
+    }
+
+    if (!info[0].IsFunction()) {
+      Napi::TypeError::New(env, "Wrong argument type, Callback expected")
+          .ThrowAsJavaScriptException();
+      return;
+    }
+
+    Napi::Function statsCallback{info[0].As<Napi::Function>()};
+
+    Napi::Array statsArray{Napi::Array::New(env)};
+    if (connection_) {
+      int i{};
+      for (const auto& stream : connection_->Stats()) {
+        Napi::Object streamStats{Napi::Object::New(env)};
+        streamStats.Set("ssrc", stream.ssrc);
+        streamStats.Set("packetsReceived",
+                        static_cast<double>(stream.packets));
+        streamStats.Set("bytesReceived",
+                        static_cast<double>(stream.payloadBytes));
+        streamStats.Set("packetsLost", static_cast<double>(stream.lost));
+        streamStats.Set("packetsReordered",
+                        static_cast<double>(stream.reordered));
+        // In milliseconds
+        streamStats.Set("jitter", stream.jitter * 1000 / stream.clockRate);
+        statsArray[i++] = streamStats;
+      }
+    }
+
+    statsCallback.Call(env.Global(), {statsArray});
+  }
+
+  std::unique_ptr<Connection> connection_;
+};
+
+Napi::FunctionReference connectionConstructor;
+
+// Shared by createVoiceConnectionWithOptions and
+// createOwnStreamConnectionWithOptions, they get the user id, an options
+// object with the address and port of the media server and a callback
+// Optionally the options map payload types to their RTP clock rate in
+// clockRates, as negotiated with the server, those not in it are taken to
+// be Opus on voice connections and video on Go Live ones
+// The callback gets an error string or null followed by the transport
+// info, IP discovery isn't done so that's the local address
+Napi::Value CreateConnection(const Napi::CallbackInfo& info,
+                             ConnectionKind kind) {
+  Napi::Env env{info.Env()};
+
+  if (info.Length() != 3) {
+    Napi::TypeError::New(env, "Wrong number of arguments, 3 expected")
+        .ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!info[1].IsObject()) {
+    Napi::TypeError::New(env, "Wrong argument type, Object expected")
+        .ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  if (!info[2].IsFunction()) {
+    Napi::TypeError::New(env, "Wrong argument type, Callback expected")
+        .ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  Napi::Object options{info[1].As<Napi::Object>()};
+
+  Napi::Function connectCallback{info[2].As<Napi::Function>()};
+
+  if (!options.Get("address").IsString() || !options.Get("port").IsNumber()) {
+    Napi::TypeError::New(env, "Options need an address and a port")
+        .ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::string address{options.Get("address").As<Napi::String>().Utf8Value()};
+  double port{options.Get("port").As<Napi::Number>().DoubleValue()};
+  if (port < 1 || port > 65535 || port != std::floor(port)) {
+    Napi::TypeError::New(env, "Port has to be an integer from 1 to 65535")
+        .ThrowAsJavaScriptException();
+    return env.Null();
+  }
+
+  std::vector<std::pair<uint8_t, uint32_t>> clockRates;
+  if (options.Has("clockRates")) {
+    Napi::Value clockRatesValue{options.Get("clockRates")};
+    if (!clockRatesValue.IsObject()) {
+      Napi::TypeError::New(env, "clockRates has to be an Object")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    Napi::Object clockRatesObject{clockRatesValue.As<Napi::Object>()};
+    Napi::Array payloadTypes{clockRatesObject.GetPropertyNames()};
+    for (uint32_t i{}; i < payloadTypes.Length(); i++) {
+      std::string key{payloadTypes.Get(i).ToString().Utf8Value()};
+      Napi::Value rate{clockRatesObject.Get(key)};
+      char* end;
+      unsigned long payloadType{strtoul(key.c_str(), &end, 10)};
+      if (*end || end == key.c_str() || payloadType > 127 ||
+          !rate.IsNumber() || rate.As<Napi::Number>().Uint32Value() == 0) {
+        Napi::TypeError::New(
+            env, "clockRates maps payload types to clock rates in Hz")
+            .ThrowAsJavaScriptException();
+        return env.Null();
+      }
+      clockRates.emplace_back(payloadType,
+                              rate.As<Napi::Number>().Uint32Value());
+    }
+  }
+
+  Napi::Object connectionObject{connectionConstructor.New({})};
+  ConnectionWrap* connection{ConnectionWrap::Unwrap(connectionObject)};
+
+  int result{connection->Open(
+      kind, address, static_cast<uint16_t>(port), clockRates)};
+  if (result < 0) {
+    connectCallback.Call(env.Global(),
+                         {Napi::String::New(env, strerror(-result))});
+  } else {
+    connectCallback.Call(env.Global(),
+                         {env.Null(), connection->TransportInfo(env)});
+  }
+
+  return connectionObject;
+}
+
+Napi::Value CreateVoiceConnectionWithOptions(const Napi::CallbackInfo& info) {
+  return CreateConnection(info, ConnectionKind::kVoice);
+}
+
+// Go Live streams, several of them can run next to a voice connection
+Napi::Value CreateOwnStreamConnectionWithOptions(
+    const Napi::CallbackInfo& info) {
+  return CreateConnection(info, ConnectionKind::kStream);
+}
+
 // This handles the objects that are exported to node
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
   // Construct the Degradation Preference Object
@@ -552,6 +887,9 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
 
   Napi::Number SupportedSecureFramesProtocolVersion{Napi::Number::New(env, 111)};
 
+  connectionConstructor = Napi::Persistent(ConnectionWrap::Define(env));
+  connectionConstructor.SuppressDestruct();
+
   exports.Set("DegradationPreference",
               DegradationPreference);
   exports.Set("SupportedSecureFramesProtocolVersion",
@@ -570,6 +908,10 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
               Napi::Function::New(env, GetInputDevices));
   exports.Set("getVideoInputDevices",
               Napi::Function::New(env, GetVideoInputDevices));
+  exports.Set("setInputDevice",
+              Napi::Function::New(env, SetInputDevice));
+  exports.Set("setOutputDevice",
+              Napi::Function::New(env, SetOutputDevice));
   exports.Set("setImageDataAllocator",
               Napi::Function::New(env, SetImageDataAllocator));
   exports.Set("setVolumeChangeCallback",
@@ -580,6 +922,10 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
               Napi::Function::New(env, SetAecDump));
   exports.Set("rankRtcRegions",
               Napi::Function::New(env, RankRtcRegions));
+  exports.Set("createVoiceConnectionWithOptions",
+              Napi::Function::New(env, CreateVoiceConnectionWithOptions));
+  exports.Set("createOwnStreamConnectionWithOptions",
+              Napi::Function::New(env, CreateOwnStreamConnectionWithOptions));
   return exports;
 }
 
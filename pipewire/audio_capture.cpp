@@ -0,0 +1,224 @@
+#include "audio_capture.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <crossfade.h>
+#include <format_converter.h>
+#include <spa/param/param.h>
+
+#include "audio_stream.h"
+#include "device_change.h"
+
+// Largest slice of a PipeWire buffer converted in one go,
+// bigger quanta are simply converted in several slices
+constexpr uint32_t kMaxSliceFrames{1024};
+// How long the old and the new device overlap when switching
+constexpr uint32_t kCrossfadeFrames{2 * kCaptureBlockFrames};
+// How far a new device may get ahead of an old one that stopped
+// delivering (usually because it was unplugged) before we give up on it
+constexpr uint32_t kStallFrames{4 * kCaptureBlockFrames};
+// Most a slice converts to, at the lowest graph rate
+constexpr uint32_t kMaxConvertedFrames{
+    kMaxSliceFrames * kCaptureSampleRate / kMinGraphRate + 2};
+
+struct capture_state;
+
+// A pw_stream plus the 48 kHz mono audio it produced
+// that hasn't been handed out in a block yet
+// The buffers are sized for any format, since the other stream reads
+// pending while crossfading they never move
+struct capture_stream {
+  capture_state* state;
+  pw_stream* stream;
+  spa_hook stream_listener;
+  ConverterHandoff converter;
+  std::array<float, kMaxConvertedFrames> converted;
+  std::array<float, kMaxConvertedFrames + kStallFrames + kCrossfadeFrames>
+      pending;
+  uint32_t pendingFrames;
+  capture_stream* nextRetired;
+};
+
+struct capture_state {
+  AudioStreamSwitch<capture_stream, capture_state> streams;
+
+  // Data thread only
+  uint32_t fadeFrames{};
+  std::array<float, kCaptureBlockFrames> block{};
+  std::array<float, kCaptureBlockFrames> fadeBlock{};
+};
+
+std::atomic<capture_block_handler*> current_capture_handler{nullptr};
+
+static void AppendCaptureFrames(capture_stream* stream,
+                                const float* frames,
+                                size_t count) {
+  size_t capacity = stream->pending.size();
+  count = std::min(count, capacity);
+  if (stream->pendingFrames + count > capacity) {
+    size_t dropped = stream->pendingFrames + count - capacity;
+    std::copy(stream->pending.begin() + dropped,
+              stream->pending.begin() + stream->pendingFrames,
+              stream->pending.begin());
+    stream->pendingFrames -= dropped;
+  }
+  std::copy_n(frames, count, stream->pending.begin() + stream->pendingFrames);
+  stream->pendingFrames += count;
+}
+
+static void PopCaptureBlock(capture_stream* stream, float* block) {
+  std::copy_n(stream->pending.begin(), kCaptureBlockFrames, block);
+  std::copy(stream->pending.begin() + kCaptureBlockFrames,
+            stream->pending.begin() + stream->pendingFrames,
+            stream->pending.begin());
+  stream->pendingFrames -= kCaptureBlockFrames;
+}
+
+// Hands out every full block, crossfading while a new device takes over
+static void DeliverCaptureBlocks(capture_state* state) {
+  capture_block_handler* ch =
+      current_capture_handler.load(std::memory_order_acquire);
+
+  while (state->streams.Active()) {
+    capture_stream* active = state->streams.Active();
+    capture_stream* incoming = state->streams.Incoming();
+    bool activeReady = active->pendingFrames >= kCaptureBlockFrames;
+
+    if (incoming && incoming->pendingFrames >= kCaptureBlockFrames) {
+      if (!activeReady && incoming->pendingFrames < kStallFrames) {
+        break;
+      }
+
+      // A stalled old device fades out from silence
+      if (activeReady) {
+        PopCaptureBlock(active, state->block.data());
+      } else {
+        state->block.fill(0.0f);
+      }
+      PopCaptureBlock(incoming, state->fadeBlock.data());
+      Crossfade(state->block.data(),
+                state->fadeBlock.data(),
+                kCaptureBlockFrames,
+                static_cast<float>(state->fadeFrames) / kCrossfadeFrames,
+                1.0f / kCrossfadeFrames);
+
+      state->fadeFrames += kCaptureBlockFrames;
+      if (state->fadeFrames >= kCrossfadeFrames) {
+        state->streams.Promote();
+        state->fadeFrames = 0;
+      }
+    } else if (activeReady) {
+      PopCaptureBlock(active, state->block.data());
+    } else {
+      break;
+    }
+
+    if (ch) {
+      (*(ch->handler))(state->block.data(), ch->data);
+    }
+  }
+}
+
+// Runs on the loop thread, the data thread picks the converter up with
+// the stream's next process call
+static void on_capture_param_changed(void* data,
+                                     uint32_t id,
+                                     const struct spa_pod* param) {
+  auto* stream = static_cast<capture_stream*>(data);
+  native_audio_format format;
+  if (id != SPA_PARAM_Format || !ParseNativeAudioFormat(param, format)) {
+    return;
+  }
+
+  stream->converter.Post(std::make_unique<FormatConverter>(
+      format.rate,
+      format.layout,
+      kCaptureSampleRate,
+      std::vector<ChannelPosition>{ChannelPosition::kMono},
+      kMaxSliceFrames));
+}
+
+// Runs on the data thread, converts whatever the device delivers
+// to 48 kHz mono and chops it into fixed 10 ms blocks
+static void on_capture_process(void* data) {
+  auto* stream = static_cast<capture_stream*>(data);
+  capture_state* state = stream->state;
+
+  if (state->streams.Adopt()) {
+    state->fadeFrames = 0;
+  }
+  // Audio converted from the old format goes
+  if (stream->converter.Adopt(state->streams.Loop())) {
+    stream->pendingFrames = 0;
+  }
+
+  pw_buffer* buffer = pw_stream_dequeue_buffer(stream->stream);
+  if (!buffer) {
+    return;
+  }
+
+  // Streams on their way in or out of the data thread just drop their audio
+  bool live = stream == state->streams.Active() ||
+              stream == state->streams.Incoming();
+  spa_data& spaData = buffer->buffer->datas[0];
+  FormatConverter* converter = stream->converter.Get();
+  if (live && converter && spaData.data && spaData.chunk) {
+    uint32_t channels = converter->InputChannels();
+    uint32_t offset = SPA_MIN(spaData.chunk->offset, spaData.maxsize);
+    uint32_t size = SPA_MIN(spaData.chunk->size, spaData.maxsize - offset);
+    const float* samples = SPA_PTROFF(spaData.data, offset, const float);
+    uint32_t frames = size / (sizeof(float) * channels);
+
+    while (frames > 0) {
+      uint32_t slice = SPA_MIN(frames, kMaxSliceFrames);
+      size_t produced =
+          converter->Process(samples, slice, stream->converted.data());
+      samples += slice * channels;
+      frames -= slice;
+
+      AppendCaptureFrames(stream, stream->converted.data(), produced);
+      DeliverCaptureBlocks(state);
+    }
+  }
+
+  pw_stream_queue_buffer(stream->stream, buffer);
+}
+
+static const struct pw_stream_events capture_stream_events = {
+    .version = PW_VERSION_STREAM_EVENTS,
+    .param_changed = on_capture_param_changed,
+    .process = on_capture_process};
+
+static const audio_stream_config capture_stream_config = {
+    .loopName = "openvoe-capture",
+    .streamName = "OpenVOE Capture",
+    .category = "Capture",
+    .direction = PW_DIRECTION_INPUT,
+    .events = &capture_stream_events,
+    .hasDevice = HasAudioInputDevice};
+
+capture_state capture{{&capture, capture_stream_config}};
+
+int StartAudioCapture() {
+  return capture.streams.Start();
+}
+
+void StopAudioCapture() {
+  capture.streams.Stop();
+}
+
+void SetAudioCaptureDevice(const std::string& guid) {
+  capture.streams.SetDevice(guid);
+}
+
+void AudioCaptureDevicesChanged() {
+  capture.streams.DevicesChanged();
+}
+
+void SetCaptureBlockHandler(capture_block_handler* new_handler) {
+  current_capture_handler.store(new_handler, std::memory_order_release);
+}
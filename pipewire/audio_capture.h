@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <pipewire/pipewire.h>
+
+// Audio is handed out in 10 ms blocks of 48 kHz mono float samples
+// whatever graph rate and channel layout the device runs at
+constexpr uint32_t kCaptureSampleRate{48000};
+constexpr uint32_t kCaptureBlockFrames{kCaptureSampleRate / 100};
+
+// Called on the PipeWire data thread for every full block
+// The handler may modify the block in place but must not block or allocate
+struct capture_block_handler {
+  void (*handler)(float* block, void* data);
+  void* data;
+};
+
+// Opens the microphone stream on its own PipeWire thread loop
+// Returns 0 on success or a negative errno
+int StartAudioCapture();
+
+void StopAudioCapture();
+
+// Selects the microphone by guid (node name), empty for the system default
+// A running capture switches over in the background and crossfades from
+// the old device, so whoever consumes the blocks never notices
+// The choice is remembered while the device is unplugged and
+// picked up again once it's back
+void SetAudioCaptureDevice(const std::string& guid);
+
+// Called by the registry whenever audio input devices come or go
+void AudioCaptureDevicesChanged();
+
+void SetCaptureBlockHandler(capture_block_handler* new_handler);
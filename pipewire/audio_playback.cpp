@@ -0,0 +1,270 @@
+#include "audio_playback.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <dsp_kernels.h>
+#include <format_converter.h>
+#include <spa/param/param.h>
+
+#include "audio_stream.h"
+#include "device_change.h"
+
+// Largest quantum we fill in one process call
+constexpr uint32_t kMaxQuantumFrames{8192};
+constexpr uint32_t kBlockSamples{kPlaybackBlockFrames * kPlaybackChannels};
+// How long the old and the new device overlap when switching
+constexpr uint32_t kCrossfadeFrames{2 * kPlaybackBlockFrames};
+// Process calls a new device may go without audio from an old one
+// (usually because it was unplugged) before it stops waiting for it
+constexpr uint32_t kStallCalls{4};
+// Most a block converts to, at the highest graph rate
+constexpr uint32_t kMaxConvertedFrames{
+    kPlaybackBlockFrames * kMaxGraphRate / kPlaybackSampleRate + 2};
+constexpr uint32_t kMaxPendingSamples{
+    (kMaxQuantumFrames + kMaxConvertedFrames) * kMaxStreamChannels};
+
+struct playback_state;
+
+// A pw_stream plus the audio it converted but the device didn't take yet
+// pending is sized for any format, so a format change never moves it
+struct playback_stream {
+  playback_state* state;
+  pw_stream* stream;
+  spa_hook stream_listener;
+  ConverterHandoff converter;
+  // Interleaved in the device's layout
+  std::array<float, kMaxPendingSamples> pending;
+  uint32_t pendingFrames;
+  // 48 kHz blocks handed over by the outgoing stream during a crossfade
+  std::array<float, kCrossfadeFrames * kPlaybackChannels> handover;
+  uint32_t handoverFrames;
+  uint32_t starvedCalls;
+  bool started;
+  playback_stream* nextRetired;
+};
+
+// Only the active stream pulls from the source, while fading it also feeds
+// the incoming one so both devices play the same audio
+struct playback_state {
+  AudioStreamSwitch<playback_stream, playback_state> streams;
+
+  // Data thread only
+  uint32_t fadeFrames{};
+  // Process calls the faded out stream waited for the incoming one to
+  // play what was handed to it
+  uint32_t waitCalls{};
+  std::array<float, kBlockSamples> block{};
+};
+
+std::atomic<playback_block_source*> current_playback_source{nullptr};
+
+// The incoming stream takes over from the active one
+static void PromotePlaybackStream(playback_state* state) {
+  state->streams.Promote();
+  state->fadeFrames = 0;
+  state->waitCalls = 0;
+}
+
+static void PullPlaybackBlock(float* block) {
+  playback_block_source* ps =
+      current_playback_source.load(std::memory_order_acquire);
+  if (ps) {
+    (*(ps->source))(block, ps->data);
+  } else {
+    std::fill_n(block, kBlockSamples, 0.0f);
+  }
+}
+
+// Works out the next 48 kHz block a stream has to play
+// The incoming stream only takes over once it played every block handed
+// to it, so the source is never pulled twice for the same stretch of time
+// and nothing gets skipped
+static void NextPlaybackBlock(playback_state* state,
+                              playback_stream* stream,
+                              float* block) {
+  if (stream == state->streams.Active()) {
+    playback_stream* incoming = state->streams.Incoming();
+    if (!incoming || !incoming->started) {
+      PullPlaybackBlock(block);
+      return;
+    }
+
+    // Faded out, the rest now comes from the incoming stream
+    if (state->fadeFrames >= kCrossfadeFrames) {
+      std::fill_n(block, kBlockSamples, 0.0f);
+      return;
+    }
+
+    PullPlaybackBlock(block);
+
+    const dsp_kernels& kernels{GetDspKernels()};
+    float position = static_cast<float>(state->fadeFrames) / kCrossfadeFrames;
+    float step = 1.0f / (kCrossfadeFrames * kPlaybackChannels);
+    uint32_t offset = incoming->handoverFrames * kPlaybackChannels;
+    float* handover = incoming->handover.data() + offset;
+    std::copy_n(block, kBlockSamples, handover);
+    kernels.gain_ramp(handover, kBlockSamples, position, step);
+    kernels.gain_ramp(block, kBlockSamples, 1.0f - position, -step);
+    incoming->handoverFrames += kPlaybackBlockFrames;
+    state->fadeFrames += kPlaybackBlockFrames;
+    return;
+  }
+
+  if (stream == state->streams.Incoming()) {
+    if (stream->handoverFrames >= kPlaybackBlockFrames) {
+      std::copy_n(stream->handover.begin(), kBlockSamples, block);
+      std::copy(stream->handover.begin() + kBlockSamples,
+                stream->handover.begin() +
+                    stream->handoverFrames * kPlaybackChannels,
+                stream->handover.begin());
+      stream->handoverFrames -= kPlaybackBlockFrames;
+      stream->starvedCalls = 0;
+      return;
+    }
+
+    // Done fading in, or a stalled old device is left behind,
+    // either way the new one pulls itself from now on
+    if (state->fadeFrames >= kCrossfadeFrames ||
+        stream->starvedCalls >= kStallCalls) {
+      PromotePlaybackStream(state);
+      PullPlaybackBlock(block);
+      return;
+    }
+  }
+
+  std::fill_n(block, kBlockSamples, 0.0f);
+}
+
+// Runs on the loop thread, the data thread picks the converter up with
+// the stream's next process call
+static void on_playback_param_changed(void* data,
+                                      uint32_t id,
+                                      const struct spa_pod* param) {
+  auto* stream = static_cast<playback_stream*>(data);
+  native_audio_format format;
+  if (id != SPA_PARAM_Format || !ParseNativeAudioFormat(param, format)) {
+    return;
+  }
+
+  stream->converter.Post(std::make_unique<FormatConverter>(
+      kPlaybackSampleRate,
+      std::vector<ChannelPosition>{ChannelPosition::kFrontLeft,
+                                   ChannelPosition::kFrontRight},
+      format.rate,
+      format.layout,
+      kPlaybackBlockFrames));
+}
+
+// Runs on the data thread, converts 10 ms blocks until there's enough
+// audio to fill the quantum the device asked for
+static void on_playback_process(void* data) {
+  auto* stream = static_cast<playback_stream*>(data);
+  playback_state* state = stream->state;
+
+  if (state->streams.Adopt()) {
+    state->fadeFrames = 0;
+    state->waitCalls = 0;
+  }
+  // Audio converted to the old format goes
+  if (stream->converter.Adopt(state->streams.Loop())) {
+    stream->pendingFrames = 0;
+  }
+
+  pw_buffer* buffer = pw_stream_dequeue_buffer(stream->stream);
+  if (!buffer) {
+    return;
+  }
+
+  spa_data& spaData = buffer->buffer->datas[0];
+  FormatConverter* converter = stream->converter.Get();
+  if (!converter || !spaData.data || !spaData.chunk) {
+    pw_stream_queue_buffer(stream->stream, buffer);
+    return;
+  }
+
+  uint32_t channels = converter->OutputChannels();
+  uint32_t stride = sizeof(float) * channels;
+  uint32_t frames = SPA_MIN(spaData.maxsize / stride, kMaxQuantumFrames);
+#if PW_CHECK_VERSION(0, 3, 49)
+  if (buffer->requested) {
+    frames = SPA_MIN(frames, static_cast<uint32_t>(buffer->requested));
+  }
+#endif
+
+  if (stream == state->streams.Incoming()) {
+    stream->started = true;
+    if (stream->handoverFrames < kPlaybackBlockFrames) {
+      stream->starvedCalls++;
+    }
+  }
+
+  // A new device that stalls after the old one faded out is given up on,
+  // the old one takes over again
+  if (stream == state->streams.Active() && state->streams.Incoming() &&
+      state->fadeFrames >= kCrossfadeFrames &&
+      ++state->waitCalls >= kStallCalls) {
+    state->streams.DropIncoming();
+    state->fadeFrames = 0;
+    state->waitCalls = 0;
+  }
+
+  while (stream->pendingFrames < frames) {
+    NextPlaybackBlock(state, stream, state->block.data());
+    stream->pendingFrames += converter->Process(
+        state->block.data(),
+        kPlaybackBlockFrames,
+        stream->pending.data() + stream->pendingFrames * channels);
+  }
+
+  float* samples = static_cast<float*>(spaData.data);
+  std::copy_n(stream->pending.begin(), frames * channels, samples);
+  std::copy(stream->pending.begin() + frames * channels,
+            stream->pending.begin() + stream->pendingFrames * channels,
+            stream->pending.begin());
+  stream->pendingFrames -= frames;
+
+  spaData.chunk->offset = 0;
+  spaData.chunk->stride = stride;
+  spaData.chunk->size = frames * stride;
+
+  pw_stream_queue_buffer(stream->stream, buffer);
+}
+
+static const struct pw_stream_events playback_stream_events = {
+    .version = PW_VERSION_STREAM_EVENTS,
+    .param_changed = on_playback_param_changed,
+    .process = on_playback_process};
+
+static const audio_stream_config playback_stream_config = {
+    .loopName = "openvoe-playback",
+    .streamName = "OpenVOE Playback",
+    .category = "Playback",
+    .direction = PW_DIRECTION_OUTPUT,
+    .events = &playback_stream_events,
+    .hasDevice = HasAudioOutputDevice};
+
+playback_state playback{{&playback, playback_stream_config}};
+
+int StartAudioPlayback() {
+  return playback.streams.Start();
+}
+
+void StopAudioPlayback() {
+  playback.streams.Stop();
+}
+
+void SetAudioPlaybackDevice(const std::string& guid) {
+  playback.streams.SetDevice(guid);
+}
+
+void AudioPlaybackDevicesChanged() {
+  playback.streams.DevicesChanged();
+}
+
+void SetPlaybackBlockSource(playback_block_source* new_source) {
+  current_playback_source.store(new_source, std::memory_order_release);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <pipewire/pipewire.h>
+
+// Audio is pulled in 10 ms blocks of 48 kHz interleaved stereo float samples
+// and converted to whatever graph rate and channel layout the device
+// runs at
+constexpr uint32_t kPlaybackSampleRate{48000};
+constexpr uint32_t kPlaybackChannels{2};
+constexpr uint32_t kPlaybackBlockFrames{kPlaybackSampleRate / 100};
+
+// Called on the PipeWire data thread whenever the device needs more audio
+// The source has to fill the whole block and must not block or allocate
+struct playback_block_source {
+  void (*source)(float* block, void* data);
+  void* data;
+};
+
+// Opens the speaker stream on its own PipeWire thread loop
+// Plays silence until a source is set
+// Returns 0 on success or a negative errno
+int StartAudioPlayback();
+
+void StopAudioPlayback();
+
+// Selects the speakers by guid (node name), empty for the system default
+// A running playback switches over in the background, fading out on the
+// old device while fading in on the new one
+// The choice is remembered while the device is unplugged and
+// picked up again once it's back
+void SetAudioPlaybackDevice(const std::string& guid);
+
+// Called by the registry whenever audio output devices come or go
+void AudioPlaybackDevicesChanged();
+
+void SetPlaybackBlockSource(playback_block_source* new_source);
@@ -0,0 +1,217 @@
+#include "audio_stream.h"
+
+#include <cerrno>
+
+#include <spa/param/audio/format-utils.h>
+
+static_assert(kMaxStreamChannels <= SPA_AUDIO_MAX_CHANNELS);
+
+static ChannelPosition ToChannelPosition(uint32_t position) {
+  switch (position) {
+    case SPA_AUDIO_CHANNEL_MONO:
+      return ChannelPosition::kMono;
+    case SPA_AUDIO_CHANNEL_FL:
+      return ChannelPosition::kFrontLeft;
+    case SPA_AUDIO_CHANNEL_FR:
+      return ChannelPosition::kFrontRight;
+    case SPA_AUDIO_CHANNEL_FC:
+      return ChannelPosition::kFrontCenter;
+    case SPA_AUDIO_CHANNEL_LFE:
+      return ChannelPosition::kLowFrequency;
+    case SPA_AUDIO_CHANNEL_SL:
+      return ChannelPosition::kSideLeft;
+    case SPA_AUDIO_CHANNEL_SR:
+      return ChannelPosition::kSideRight;
+    case SPA_AUDIO_CHANNEL_RL:
+      return ChannelPosition::kRearLeft;
+    case SPA_AUDIO_CHANNEL_RR:
+      return ChannelPosition::kRearRight;
+    default:
+      return ChannelPosition::kOther;
+  }
+}
+
+int CreateAudioStreamLoop(audio_stream_loop& streamLoop, const char* name) {
+  pw_init(NULL, NULL);
+
+  streamLoop = audio_stream_loop{};
+  streamLoop.loop = pw_thread_loop_new(name, NULL /* properties */);
+  if (!streamLoop.loop) {
+    return -errno;
+  }
+
+  streamLoop.context = pw_context_new(pw_thread_loop_get_loop(streamLoop.loop),
+                                      NULL /* properties */,
+                                      0 /* user_data size */);
+  int result = streamLoop.context ? 0 : -errno;
+  if (result == 0) {
+    result = pw_thread_loop_start(streamLoop.loop);
+  }
+
+  if (result == 0) {
+    pw_thread_loop_lock(streamLoop.loop);
+    streamLoop.core = pw_context_connect(
+        streamLoop.context, NULL /* properties */, 0 /* user_data size */);
+    result = streamLoop.core ? 0 : -errno;
+    pw_thread_loop_unlock(streamLoop.loop);
+  }
+
+  if (result < 0) {
+    DestroyAudioStreamLoop(streamLoop);
+  }
+
+  return result;
+}
+
+void DestroyAudioStreamLoop(audio_stream_loop& streamLoop) {
+  if (streamLoop.core) {
+    pw_thread_loop_lock(streamLoop.loop);
+    pw_core_disconnect(streamLoop.core);
+    pw_thread_loop_unlock(streamLoop.loop);
+  }
+
+  if (streamLoop.loop) {
+    pw_thread_loop_stop(streamLoop.loop);
+  }
+
+  if (streamLoop.context) {
+    pw_context_destroy(streamLoop.context);
+  }
+
+  if (streamLoop.loop) {
+    pw_thread_loop_destroy(streamLoop.loop);
+  }
+
+  streamLoop = audio_stream_loop{};
+}
+
+pw_stream* NewAudioStream(audio_stream_loop& streamLoop,
+                          const char* name,
+                          const char* category,
+                          pw_direction direction,
+                          const std::string& target,
+                          spa_hook* listener,
+                          const pw_stream_events* events,
+                          void* data) {
+  pw_properties* props = pw_properties_new(PW_KEY_MEDIA_TYPE,
+                                           "Audio",
+                                           PW_KEY_MEDIA_CATEGORY,
+                                           category,
+                                           PW_KEY_MEDIA_ROLE,
+                                           "Communication",
+                                           PW_KEY_NODE_LATENCY,
+                                           "480/48000",
+                                           PW_KEY_STREAM_DONT_REMIX,
+                                           "true",
+                                           NULL);
+  if (!target.empty()) {
+#ifdef PW_KEY_TARGET_OBJECT
+    pw_properties_set(props, PW_KEY_TARGET_OBJECT, target.c_str());
+#else
+    pw_properties_set(props, PW_KEY_NODE_TARGET, target.c_str());
+#endif
+  }
+
+  pw_stream* stream = pw_stream_new(streamLoop.core, name, props);
+  if (!stream) {
+    return nullptr;
+  }
+
+  spa_zero(*listener);
+  pw_stream_add_listener(stream, listener, events, data);
+
+  uint8_t podBuffer[1024];
+  spa_pod_builder builder = SPA_POD_BUILDER_INIT(podBuffer, sizeof(podBuffer));
+
+  // Leaving rate and channels at 0 keeps them out of the pod, the adapter
+  // then offers the graph rate and the device's channels
+  spa_audio_info_raw info{};
+  info.format = SPA_AUDIO_FORMAT_F32;
+  const spa_pod* params[1];
+  params[0] = spa_format_audio_raw_build(&builder, SPA_PARAM_EnumFormat, &info);
+
+  if (pw_stream_connect(
+          stream,
+          direction,
+          PW_ID_ANY,
+          static_cast<pw_stream_flags>(PW_STREAM_FLAG_AUTOCONNECT |
+                                       PW_STREAM_FLAG_MAP_BUFFERS |
+                                       PW_STREAM_FLAG_RT_PROCESS),
+          params,
+          1) < 0) {
+    pw_stream_destroy(stream);
+    return nullptr;
+  }
+
+  return stream;
+}
+
+bool ParseNativeAudioFormat(const spa_pod* param, native_audio_format& format) {
+  uint32_t mediaType;
+  uint32_t mediaSubtype;
+  if (!param || spa_format_parse(param, &mediaType, &mediaSubtype) < 0 ||
+      mediaType != SPA_MEDIA_TYPE_audio ||
+      mediaSubtype != SPA_MEDIA_SUBTYPE_raw) {
+    return false;
+  }
+
+  spa_audio_info_raw info{};
+  if (spa_format_audio_raw_parse(param, &info) < 0 ||
+      info.format != SPA_AUDIO_FORMAT_F32 || info.rate < kMinGraphRate ||
+      info.rate > kMaxGraphRate || info.channels == 0 ||
+      info.channels > kMaxStreamChannels) {
+    return false;
+  }
+
+  format.rate = info.rate;
+  if (info.flags & SPA_AUDIO_FLAG_UNPOSITIONED) {
+    format.layout = DefaultChannelLayout(info.channels);
+  } else {
+    format.layout.resize(info.channels);
+    for (uint32_t c{}; c < info.channels; c++) {
+      format.layout[c] = ToChannelPosition(info.position[c]);
+    }
+  }
+
+  return true;
+}
+
+ConverterHandoff::~ConverterHandoff() {
+  delete next_.load(std::memory_order_acquire);
+}
+
+void ConverterHandoff::Post(std::unique_ptr<FormatConverter> converter) {
+  delete next_.exchange(converter.release(), std::memory_order_acq_rel);
+}
+
+// Runs on the loop thread
+static int do_free_converter(struct spa_loop*,
+                             bool,
+                             uint32_t,
+                             const void* data,
+                             size_t,
+                             void*) {
+  delete *static_cast<FormatConverter* const*>(data);
+  return 0;
+}
+
+bool ConverterHandoff::Adopt(pw_thread_loop* loop) {
+  FormatConverter* next = next_.exchange(nullptr, std::memory_order_acq_rel);
+  if (!next) {
+    return false;
+  }
+
+  // The pointer is copied into the loop's queue
+  FormatConverter* old = current_.release();
+  current_.reset(next);
+  if (old) {
+    pw_loop_invoke(pw_thread_loop_get_loop(loop),
+                   do_free_converter,
+                   SPA_ID_INVALID,
+                   &old,
+                   sizeof(old),
+                   false,
+                   nullptr);
+  }
+  return true;
+}
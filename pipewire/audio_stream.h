@@ -0,0 +1,371 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <channel_mixer.h>
+#include <format_converter.h>
+#include <pipewire/pipewire.h>
+
+// Streams are converted by our own FormatConverter, so we ask the
+// adapter for plain F32 in the device's channel layout at the graph clock
+// rate instead of letting it resample and remix for us
+// PipeWire runs a device at the graph rate, a device whose hardware can't
+// do that rate is resampled by its own adapter, which a client stream
+// can't bypass, so the rate here is the graph's and not always the
+// hardware's
+// Formats outside these limits are turned down, so streams can size their
+// buffers for the worst case once and never reallocate them
+constexpr uint32_t kMinGraphRate{8000};
+constexpr uint32_t kMaxGraphRate{384000};
+constexpr uint32_t kMaxStreamChannels{64};
+
+struct native_audio_format {
+  uint32_t rate;
+  std::vector<ChannelPosition> layout;
+};
+
+// A thread loop with a context of its own
+// Every stream created on it shares the context's data thread, so the
+// process callbacks of an outgoing and an incoming stream never run
+// concurrently and can hand audio to each other without locks
+struct audio_stream_loop {
+  pw_thread_loop* loop;
+  pw_context* context;
+  pw_core* core;
+};
+
+// Returns 0 on success or a negative errno
+int CreateAudioStreamLoop(audio_stream_loop& streamLoop, const char* name);
+
+// Streams created on the loop have to be destroyed first
+void DestroyAudioStreamLoop(audio_stream_loop& streamLoop);
+
+// Creates and connects a stream, target is the node name of the device
+// to link to or empty for the default one
+// Has to be called with the thread loop locked, returns nullptr on failure
+pw_stream* NewAudioStream(audio_stream_loop& streamLoop,
+                          const char* name,
+                          const char* category,
+                          pw_direction direction,
+                          const std::string& target,
+                          spa_hook* listener,
+                          const pw_stream_events* events,
+                          void* data);
+
+// Parses the SPA_PARAM_Format handed to param_changed
+// Returns false if it isn't raw F32 audio within the limits above
+bool ParseNativeAudioFormat(const spa_pod* param, native_audio_format& format);
+
+// Hands the converter param_changed makes on the loop thread over to
+// process on the data thread, the same way streams are handed over
+// The data thread never allocates or frees a converter, and the loop
+// thread never touches one the data thread is using
+class ConverterHandoff {
+ public:
+  ~ConverterHandoff();
+
+  // Loop thread, replaces a converter that wasn't picked up yet
+  void Post(std::unique_ptr<FormatConverter> converter);
+
+  // Data thread, swaps in the converter posted last and sends the old one
+  // to loop to be freed
+  // Returns true if the converter changed
+  bool Adopt(pw_thread_loop* loop);
+
+  // Data thread, nullptr until the format is known
+  FormatConverter* Get() const { return current_.get(); }
+
+ private:
+  std::unique_ptr<FormatConverter> current_;
+  std::atomic<FormatConverter*> next_{nullptr};
+};
+
+// What the streams of a capture or a playback are opened with
+struct audio_stream_config {
+  const char* loopName;
+  const char* streamName;
+  const char* category;
+  pw_direction direction;
+  const pw_stream_events* events;
+  // Whether the device with the given guid (node name) is plugged in
+  bool (*hasDevice)(const std::string& guid);
+};
+
+// Moves a capture or a playback from one device to another in the
+// background, with a stream per device on a loop of their own
+// Streams are created and destroyed by the loop thread but only the data
+// thread decides which of them is live, so switching devices never takes
+// a lock on the data thread
+// New streams travel to the data thread through a mailbox and go back
+// through a stack of retired streams that the loop thread reaps
+// Stream has to have a State* state, a pw_stream* stream, a spa_hook
+// stream_listener and a Stream* nextRetired, the events get the Stream
+template <typename Stream, typename State>
+class AudioStreamSwitch {
+ public:
+  AudioStreamSwitch(State* state, const audio_stream_config& config)
+      : state_{state}, config_{config} {}
+
+  AudioStreamSwitch(const AudioStreamSwitch&) = delete;
+  AudioStreamSwitch& operator=(const AudioStreamSwitch&) = delete;
+
+  // Opens the loop and a stream on the selected device
+  // Returns 0 on success or a negative errno
+  int Start();
+
+  void Stop();
+
+  // Selects the device by guid, empty for the system default
+  // The choice is remembered while the device is unplugged and
+  // picked up again once it's back
+  void SetDevice(const std::string& guid);
+
+  // Called whenever devices come or go
+  void DevicesChanged();
+
+  // Data thread only from here on
+  // Picks up the newest stream, returns true if it's a new incoming one
+  // the active stream has to hand over to
+  bool Adopt();
+
+  Stream* Active() const { return active_; }
+
+  Stream* Incoming() const { return incoming_; }
+
+  // The thread loop the streams live on
+  pw_thread_loop* Loop() const { return streamLoop_.loop; }
+
+  // The incoming stream takes over from the active one
+  void Promote();
+
+  // Gives up on the incoming stream, the active one stays
+  void DropIncoming();
+
+ private:
+  static int DoReap(struct spa_loop*,
+                    bool,
+                    uint32_t,
+                    const void*,
+                    size_t,
+                    void* user_data);
+
+  void Destroy(Stream* stream);
+  void Retire(Stream* stream);
+  std::string Target() const;
+  int Switch();
+  void UpdateTarget();
+
+  State* state_;
+  audio_stream_config config_;
+
+  // Guards everything the loop thread owns against the JavaScript thread
+  std::mutex mutex_;
+  audio_stream_loop streamLoop_{};
+  std::vector<std::unique_ptr<Stream>> streams_;
+  // The device that was asked for and the one the newest stream targets
+  std::string device_;
+  std::string target_;
+  std::atomic<Stream*> adopt_{nullptr};
+  std::atomic<Stream*> retired_{nullptr};
+
+  Stream* active_{};
+  Stream* incoming_{};
+};
+
+template <typename Stream, typename State>
+int AudioStreamSwitch<Stream, State>::Start() {
+  std::scoped_lock lock{mutex_};
+  if (streamLoop_.loop) {
+    return 0;
+  }
+
+  int result = CreateAudioStreamLoop(streamLoop_, config_.loopName);
+  if (result < 0) {
+    return result;
+  }
+
+  pw_thread_loop_lock(streamLoop_.loop);
+  target_ = Target();
+  result = Switch();
+  pw_thread_loop_unlock(streamLoop_.loop);
+
+  if (result < 0) {
+    DestroyAudioStreamLoop(streamLoop_);
+  }
+
+  return result;
+}
+
+template <typename Stream, typename State>
+void AudioStreamSwitch<Stream, State>::Stop() {
+  std::scoped_lock lock{mutex_};
+  if (!streamLoop_.loop) {
+    return;
+  }
+
+  pw_thread_loop_lock(streamLoop_.loop);
+  for (const auto& stream : streams_) {
+    pw_stream_destroy(stream->stream);
+  }
+
+  // Nothing runs on the data thread anymore,
+  // so whatever was in flight between the threads can go
+  adopt_.store(nullptr, std::memory_order_relaxed);
+  retired_.store(nullptr, std::memory_order_relaxed);
+  active_ = nullptr;
+  incoming_ = nullptr;
+  streams_.clear();
+  pw_thread_loop_unlock(streamLoop_.loop);
+
+  DestroyAudioStreamLoop(streamLoop_);
+}
+
+template <typename Stream, typename State>
+void AudioStreamSwitch<Stream, State>::SetDevice(const std::string& guid) {
+  std::scoped_lock lock{mutex_};
+  device_ = guid;
+  UpdateTarget();
+}
+
+template <typename Stream, typename State>
+void AudioStreamSwitch<Stream, State>::DevicesChanged() {
+  std::scoped_lock lock{mutex_};
+  UpdateTarget();
+}
+
+template <typename Stream, typename State>
+bool AudioStreamSwitch<Stream, State>::Adopt() {
+  Stream* stream = adopt_.exchange(nullptr, std::memory_order_acquire);
+  if (!stream) {
+    return false;
+  }
+
+  if (!active_) {
+    active_ = stream;
+    return false;
+  }
+
+  // Switching again before the last switch finished drops
+  // the device we were fading to and fades to the newest one instead
+  if (incoming_) {
+    Retire(incoming_);
+  }
+  incoming_ = stream;
+  return true;
+}
+
+template <typename Stream, typename State>
+void AudioStreamSwitch<Stream, State>::Promote() {
+  Retire(active_);
+  active_ = incoming_;
+  incoming_ = nullptr;
+}
+
+template <typename Stream, typename State>
+void AudioStreamSwitch<Stream, State>::DropIncoming() {
+  Retire(incoming_);
+  incoming_ = nullptr;
+}
+
+// Runs on the loop thread
+template <typename Stream, typename State>
+int AudioStreamSwitch<Stream, State>::DoReap(struct spa_loop*,
+                                             bool,
+                                             uint32_t,
+                                             const void*,
+                                             size_t,
+                                             void* user_data) {
+  auto* streamSwitch = static_cast<AudioStreamSwitch*>(user_data);
+  Stream* stream =
+      streamSwitch->retired_.exchange(nullptr, std::memory_order_acquire);
+  while (stream) {
+    Stream* next = stream->nextRetired;
+    streamSwitch->Destroy(stream);
+    stream = next;
+  }
+  return 0;
+}
+
+template <typename Stream, typename State>
+void AudioStreamSwitch<Stream, State>::Destroy(Stream* stream) {
+  pw_stream_destroy(stream->stream);
+  std::erase_if(streams_, [stream](const auto& owned) {
+    return owned.get() == stream;
+  });
+}
+
+template <typename Stream, typename State>
+void AudioStreamSwitch<Stream, State>::Retire(Stream* stream) {
+  stream->nextRetired = retired_.load(std::memory_order_relaxed);
+  while (!retired_.compare_exchange_weak(stream->nextRetired,
+                                         stream,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+  }
+  pw_loop_invoke(pw_thread_loop_get_loop(streamLoop_.loop),
+                 DoReap,
+                 SPA_ID_INVALID,
+                 NULL,
+                 0,
+                 false,
+                 this);
+}
+
+// The selected device while it's plugged in, the default one otherwise
+template <typename Stream, typename State>
+std::string AudioStreamSwitch<Stream, State>::Target() const {
+  return !device_.empty() && config_.hasDevice(device_) ? device_ : "";
+}
+
+// Opens a stream on target_ and queues it for the data thread
+// Called with the thread loop locked
+template <typename Stream, typename State>
+int AudioStreamSwitch<Stream, State>::Switch() {
+  auto stream = std::make_unique<Stream>();
+  stream->state = state_;
+  stream->stream = NewAudioStream(streamLoop_,
+                                  config_.streamName,
+                                  config_.category,
+                                  config_.direction,
+                                  target_,
+                                  &stream->stream_listener,
+                                  config_.events,
+                                  stream.get());
+  if (!stream->stream) {
+    return -errno;
+  }
+
+  Stream* skipped = adopt_.exchange(stream.get(), std::memory_order_acq_rel);
+  streams_.push_back(std::move(stream));
+
+  // The data thread never got to see this one
+  if (skipped) {
+    Destroy(skipped);
+  }
+
+  return 0;
+}
+
+// Called with mutex_ held
+template <typename Stream, typename State>
+void AudioStreamSwitch<Stream, State>::UpdateTarget() {
+  if (!streamLoop_.loop) {
+    return;
+  }
+
+  std::string target = Target();
+  if (target == target_) {
+    return;
+  }
+
+  pw_thread_loop_lock(streamLoop_.loop);
+  target_ = target;
+  Switch();
+  pw_thread_loop_unlock(streamLoop_.loop);
+}
@@ -2,10 +2,18 @@
 
 #include <atomic>
 #include <mutex>
+#include <unordered_map>
+
+#include "audio_capture.h"
+#include "audio_playback.h"
 
 std::list<device_with_id> audioInputDevices{};
 std::list<device_with_id> audioOutputDevices{};
 std::list<device_with_id> videoInputDevices{};
+// node_name -> id of every audio device, so selecting one by guid
+// doesn't have to walk the lists
+std::unordered_map<std::string, uint32_t> audioInputIndex{};
+std::unordered_map<std::string, uint32_t> audioOutputIndex{};
 std::mutex devices_mutex{};
 
 std::atomic<callback_executor*> current_executor{nullptr};
@@ -30,17 +38,21 @@ static void registry_event_global(void*,
                                                         : "";
 
   bool deviceAdded{};
+  bool audioInputAdded{};
+  bool audioOutputAdded{};
   {
     std::scoped_lock lock{devices_mutex};
     if (media_class == "Audio/Source" ||
         media_class == "Audio/Source/Virtual" ||
         media_class == "Audio/Duplex") {
       audioInputDevices.push_back({node_description, node_name, id});
-      deviceAdded = true;
+      audioInputIndex[node_name] = id;
+      deviceAdded = audioInputAdded = true;
     }
     if (media_class == "Audio/Sink" || media_class == "Audio/Duplex") {
       audioOutputDevices.push_back({node_description, node_name, id});
-      deviceAdded = true;
+      audioOutputIndex[node_name] = id;
+      deviceAdded = audioOutputAdded = true;
     }
     if (media_class == "Video/Source") {
       videoInputDevices.push_back({node_description, node_name, id});
@@ -48,6 +60,14 @@ static void registry_event_global(void*,
     }
   }
 
+  // A selected device that comes back gets picked up again
+  if (audioInputAdded) {
+    AudioCaptureDevicesChanged();
+  }
+  if (audioOutputAdded) {
+    AudioPlaybackDevicesChanged();
+  }
+
   if (deviceAdded && ce) {
     (*(ce->executor))(ce->callback);
   }
@@ -56,6 +76,8 @@ static void registry_event_global(void*,
 static void registry_event_global_remove(void* data, uint32_t id) {
   callback_executor* ce = current_executor.load(std::memory_order_acquire);
   bool deviceRemoved{};
+  bool audioInputRemoved{};
+  bool audioOutputRemoved{};
   {
     std::scoped_lock lock{devices_mutex};
     auto pred = [id, &deviceRemoved](device_with_id device) {
@@ -66,11 +88,35 @@ static void registry_event_global_remove(void* data, uint32_t id) {
         return false;
       }
     };
+    auto unindex = [id](std::unordered_map<std::string, uint32_t>& index,
+                        const std::list<device_with_id>& devices) {
+      for (const auto& device : devices) {
+        if (device.id == id) {
+          auto entry = index.find(device.name);
+          if (entry != index.end() && entry->second == id) {
+            index.erase(entry);
+          }
+          return true;
+        }
+      }
+      return false;
+    };
 
+    audioInputRemoved = unindex(audioInputIndex, audioInputDevices);
+    audioOutputRemoved = unindex(audioOutputIndex, audioOutputDevices);
     std::erase_if(audioInputDevices, pred);
     std::erase_if(audioOutputDevices, pred);
     std::erase_if(videoInputDevices, pred);
   }
+
+  // Streams on a device that went away fall back to the default one
+  if (audioInputRemoved) {
+    AudioCaptureDevicesChanged();
+  }
+  if (audioOutputRemoved) {
+    AudioPlaybackDevicesChanged();
+  }
+
   if (deviceRemoved && ce) {
     (*(ce->executor))(ce->callback);
   }
@@ -137,3 +183,13 @@ std::list<device_with_id> GetVideoDevices() {
   std::scoped_lock lock{devices_mutex};
   return std::list<device_with_id>{videoInputDevices};
 }
+
+bool HasAudioInputDevice(const std::string& guid) {
+  std::scoped_lock lock{devices_mutex};
+  return audioInputIndex.contains(guid);
+}
+
+bool HasAudioOutputDevice(const std::string& guid) {
+  std::scoped_lock lock{devices_mutex};
+  return audioOutputIndex.contains(guid);
+}
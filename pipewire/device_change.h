@@ -28,3 +28,9 @@ std::list<device_with_id> GetAudioInputDevices();
 std::list<device_with_id> GetAudioOutputDevices();
 
 std::list<device_with_id> GetVideoDevices();
+
+// Audio devices are identified by their node name, which unlike the
+// position in the lists above stays the same across hot-plugs
+bool HasAudioInputDevice(const std::string& guid);
+
+bool HasAudioOutputDevice(const std::string& guid);
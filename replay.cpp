@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <rtp_receiver.h>
+#include <rtp_recording.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Feeds an RTP recording made by the transport back through the receive
+// pipeline without any network, so jitter buffer and decoder changes can
+// be measured against the exact same real world traffic every time
+// Packets go in as fast as possible unless --realtime asks for them to be
+// spaced out the way they originally arrived
+
+void PrintUsage(const char* name) {
+  fprintf(stderr,
+          "Usage: %s [--realtime] [--clock-rate [PT=]HZ]... RECORDING\n"
+          "  --realtime            replay at the pace the packets arrived\n"
+          "  --clock-rate HZ       RTP timestamp rate, defaults to 48000\n"
+          "  --clock-rate PT=HZ    RTP timestamp rate of one payload type,\n"
+          "                        90000 for video streams\n",
+          name);
+}
+
+int main(int argc, char** argv) {
+  bool realtime{false};
+  uint32_t clockRate{48000};
+  // Payload type and rate pairs
+  std::vector<std::pair<uint32_t, uint32_t>> clockRates;
+  const char* path{nullptr};
+
+  for (int i{1}; i < argc; i++) {
+    if (!strcmp(argv[i], "--realtime")) {
+      realtime = true;
+    } else if (!strcmp(argv[i], "--clock-rate") && i + 1 < argc) {
+      char* end;
+      uint32_t value = strtoul(argv[++i], &end, 10);
+      if (*end == '=') {
+        uint32_t rate = strtoul(end + 1, nullptr, 10);
+        if (value > 127 || rate == 0) {
+          PrintUsage(argv[0]);
+          return EXIT_FAILURE;
+        }
+        clockRates.emplace_back(value, rate);
+      } else {
+        clockRate = value;
+      }
+    } else if (argv[i][0] != '-' && !path) {
+      path = argv[i];
+    } else {
+      PrintUsage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!path || clockRate == 0) {
+    PrintUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  RtpRecording recording;
+  int result = recording.Open(path);
+  if (result < 0) {
+    fprintf(stderr, "%s: %s\n", path, strerror(-result));
+    return EXIT_FAILURE;
+  }
+
+  RtpReceiver receiver{clockRate};
+  for (auto [payloadType, rate] : clockRates) {
+    receiver.SetClockRate(payloadType, rate);
+  }
+  uint64_t packets{};
+  uint64_t duration{};
+
+  // Arrival times are replayed relative to a fresh steady clock origin
+  auto start = std::chrono::steady_clock::now();
+  rtp_record record;
+  while (recording.Next(record)) {
+    auto arrival = start + std::chrono::nanoseconds{record.arrivalNs};
+    if (realtime) {
+      std::this_thread::sleep_until(arrival);
+    }
+
+    uint64_t arrivalNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             arrival.time_since_epoch())
+                             .count();
+    receiver.Receive(record.packet, record.size, arrivalNs);
+    packets++;
+    duration = std::max(duration, record.arrivalNs);
+  }
+  std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() -
+                                        start};
+
+  printf("%llu packets (%llu invalid), %.3f s of traffic in %.3f s, "
+         "%.0f packets/s\n",
+         static_cast<unsigned long long>(packets),
+         static_cast<unsigned long long>(receiver.Invalid()),
+         duration / 1e9,
+         elapsed.count(),
+         packets / elapsed.count());
+
+  for (const auto& stats : receiver.Stats()) {
+    printf("ssrc %08x: %llu packets, %llu payload bytes, %lld lost, "
+           "%llu reordered, jitter %.2f ms at %u Hz\n",
+           stats.ssrc,
+           static_cast<unsigned long long>(stats.packets),
+           static_cast<unsigned long long>(stats.payloadBytes),
+           static_cast<long long>(stats.lost),
+           static_cast<unsigned long long>(stats.reordered),
+           stats.jitter * 1000 / stats.clockRate,
+           stats.clockRate);
+  }
+
+  return EXIT_SUCCESS;
+}
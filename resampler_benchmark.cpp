@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numbers>
+#include <resampler.h>
+#include <vector>
+
+// Measures the quality and speed of the Resampler for the rate pairs
+// devices commonly run at
+// A sine goes through in 10 ms chunks, a sine of the same frequency is
+// fitted to what comes out (which takes care of the delay) and whatever
+// doesn't fit counts as noise and distortion
+
+struct benchmark_result {
+  double snr;
+  double microseconds;
+  size_t frames;
+  size_t expected;
+};
+
+benchmark_result Run(uint32_t inputRate, uint32_t outputRate, double hz) {
+  constexpr double kSeconds{2.0};
+  size_t chunk{inputRate / 100};
+  size_t inputFrames{static_cast<size_t>(inputRate * kSeconds)};
+
+  std::vector<float> input(inputFrames);
+  for (size_t i{}; i < inputFrames; i++) {
+    input[i] = 0.5f * static_cast<float>(std::sin(
+                          2.0 * std::numbers::pi * hz * i / inputRate));
+  }
+
+  Resampler resampler{inputRate, outputRate, chunk};
+  std::vector<float> output(resampler.MaxOutputFrames(inputFrames) +
+                            inputFrames / chunk * 2);
+  size_t produced{};
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i{}; i + chunk <= inputFrames; i += chunk) {
+    produced +=
+        resampler.Process(input.data() + i, chunk, output.data() + produced);
+  }
+  std::chrono::duration<double, std::micro> elapsed{
+      std::chrono::steady_clock::now() - start};
+
+  // Least squares fit of a sin + b cos, skipping the filter's ramp up
+  size_t skip{outputRate / 20};
+  double ss{}, cc{}, sc{}, ys{}, yc{};
+  for (size_t i{skip}; i < produced; i++) {
+    double t{2.0 * std::numbers::pi * hz * i / outputRate};
+    double s{std::sin(t)};
+    double c{std::cos(t)};
+    ss += s * s;
+    cc += c * c;
+    sc += s * c;
+    ys += output[i] * s;
+    yc += output[i] * c;
+  }
+  double determinant{ss * cc - sc * sc};
+  double a{(ys * cc - yc * sc) / determinant};
+  double b{(yc * ss - ys * sc) / determinant};
+
+  double signal{};
+  double noise{};
+  for (size_t i{skip}; i < produced; i++) {
+    double t{2.0 * std::numbers::pi * hz * i / outputRate};
+    double fitted{a * std::sin(t) + b * std::cos(t)};
+    signal += fitted * fitted;
+    noise += (output[i] - fitted) * (output[i] - fitted);
+  }
+
+  return {10.0 * std::log10(signal / noise),
+          elapsed.count() / (inputFrames / chunk),
+          produced,
+          static_cast<size_t>(outputRate * kSeconds)};
+}
+
+int main() {
+  constexpr uint32_t kRates[][2]{{44100, 48000},
+                                 {48000, 44100},
+                                 {96000, 48000},
+                                 {48000, 96000},
+                                 {16000, 48000},
+                                 {48000, 16000},
+                                 {32000, 48000}};
+  for (const auto& rates : kRates) {
+    // Low in the passband and 80% of the way to the lower Nyquist frequency
+    double frequencies[]{1000.0, 0.4 * std::min(rates[0], rates[1])};
+    for (double hz : frequencies) {
+      benchmark_result result{Run(rates[0], rates[1], hz)};
+      printf("%6u -> %6u Hz, %5.0f Hz sine: %5.1f dB SNR, %5.1f us per 10 ms"
+             ", %zu of %zu frames\n",
+             rates[0],
+             rates[1],
+             hz,
+             result.snr,
+             result.microseconds,
+             result.frames,
+             result.expected);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+#include "connection.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+// Voice only carries Opus, which always ticks at 48 kHz, Go Live is
+// mostly video at 90 kHz and its audio gets a rate by payload type
+static uint32_t DefaultClockRate(ConnectionKind kind) {
+  return kind == ConnectionKind::kVoice ? 48000 : 90000;
+}
+
+Connection::Connection(ConnectionKind kind,
+                       SocketPoller& poller,
+                       RtpRecorder* recorder)
+    : kind_{kind},
+      poller_{poller},
+      handler_{OnReadable, this},
+      receiver_{DefaultClockRate(kind)} {
+  receiver_.SetRecorder(recorder);
+}
+
+Connection::~Connection() {
+  Close();
+}
+
+void Connection::SetClockRate(uint8_t payloadType, uint32_t clockRate) {
+  std::scoped_lock lock{receiverMutex_};
+  receiver_.SetClockRate(payloadType, clockRate);
+}
+
+int Connection::Connect(const std::string& address, uint16_t port) {
+  Close();
+
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+
+  addrinfo* result;
+  std::string service{std::to_string(port)};
+  if (getaddrinfo(address.c_str(), service.c_str(), &hints, &result) != 0) {
+    return -EINVAL;
+  }
+
+  // The kernel stamps every datagram as it comes in, so a batch read
+  // after a delay still gets the times the packets really arrived
+  int enable{1};
+  int fd = socket(result->ai_family,
+                  SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                  result->ai_protocol);
+  if (fd < 0 ||
+      setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) <
+          0 ||
+      connect(fd, result->ai_addr, result->ai_addrlen) < 0) {
+    int error = -errno;
+    if (fd >= 0) close(fd);
+    freeaddrinfo(result);
+    return error;
+  }
+  freeaddrinfo(result);
+
+  int error = poller_.Add(fd, &handler_);
+  if (error < 0) {
+    close(fd);
+    return error;
+  }
+
+  fd_ = fd;
+  return 0;
+}
+
+void Connection::Close() {
+  if (fd_ < 0) {
+    return;
+  }
+
+  poller_.Remove(fd_);
+  close(fd_);
+  fd_ = -1;
+}
+
+bool Connection::LocalAddress(std::string& address, uint16_t& port) const {
+  sockaddr_storage local;
+  socklen_t length{sizeof(local)};
+  if (fd_ < 0 ||
+      getsockname(fd_, reinterpret_cast<sockaddr*>(&local), &length) < 0) {
+    return false;
+  }
+
+  char host[NI_MAXHOST];
+  char service[NI_MAXSERV];
+  if (getnameinfo(reinterpret_cast<sockaddr*>(&local),
+                  length,
+                  host,
+                  sizeof(host),
+                  service,
+                  sizeof(service),
+                  NI_NUMERICHOST | NI_NUMERICSERV) != 0) {
+    return false;
+  }
+
+  address = host;
+  port = static_cast<uint16_t>(std::stoi(service));
+  return true;
+}
+
+std::vector<rtp_stream_stats> Connection::Stats() {
+  std::scoped_lock lock{receiverMutex_};
+  return receiver_.Stats();
+}
+
+// Kernel timestamps are CLOCK_REALTIME, receivers want the steady clock
+// Falls back to now for a datagram that came without one
+static uint64_t ArrivalNs(msghdr& message,
+                          int64_t realtimeToSteadyNs,
+                          uint64_t nowNs) {
+  for (cmsghdr* control = CMSG_FIRSTHDR(&message); control;
+       control = CMSG_NXTHDR(&message, control)) {
+    if (control->cmsg_level == SOL_SOCKET &&
+        control->cmsg_type == SCM_TIMESTAMPNS) {
+      timespec stamp;
+      std::memcpy(&stamp, CMSG_DATA(control), sizeof(stamp));
+      int64_t arrivalNs =
+          stamp.tv_sec * int64_t{1000000000} + stamp.tv_nsec +
+          realtimeToSteadyNs;
+      // A wall clock step can't put a packet after it was read
+      return std::min<uint64_t>(arrivalNs, nowNs);
+    }
+  }
+  return nowNs;
+}
+
+static int64_t ClockNs(clockid_t clock) {
+  timespec now;
+  clock_gettime(clock, &now);
+  return now.tv_sec * int64_t{1000000000} + now.tv_nsec;
+}
+
+// Runs on the pool, drains the socket a batch at a time
+void Connection::OnReadable(int fd, void* data) {
+  auto* connection = static_cast<Connection*>(data);
+  std::scoped_lock lock{connection->receiverMutex_};
+
+  iovec iovecs[kBatchSize];
+  mmsghdr messages[kBatchSize]{};
+  for (size_t i{}; i < kBatchSize; i++) {
+    iovecs[i].iov_base = connection->packets_[i].data();
+    iovecs[i].iov_len = kMaxPacketSize;
+    messages[i].msg_hdr.msg_iov = &iovecs[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+    messages[i].msg_hdr.msg_control = connection->controls_[i].data;
+  }
+
+  while (true) {
+    // The kernel shrinks it to what it filled in
+    for (size_t i{}; i < kBatchSize; i++) {
+      messages[i].msg_hdr.msg_controllen = kControlSize;
+    }
+
+    int count = recvmmsg(fd, messages, kBatchSize, 0, nullptr);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        perror("recvmmsg");
+      }
+      return;
+    }
+
+    int64_t nowNs = ClockNs(CLOCK_MONOTONIC);
+    int64_t realtimeToSteadyNs = nowNs - ClockNs(CLOCK_REALTIME);
+
+    for (int i{}; i < count; i++) {
+      connection->receiver_.Receive(
+          connection->packets_[i].data(),
+          messages[i].msg_len,
+          ArrivalNs(messages[i].msg_hdr, realtimeToSteadyNs, nowNs));
+    }
+  }
+}
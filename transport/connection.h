@@ -0,0 +1,74 @@
+#pragma once
+
+#include <sys/socket.h>
+
+#include <array>
+#include <ctime>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rtp_receiver.h"
+#include "rtp_recording.h"
+#include "socket_poller.h"
+
+enum class ConnectionKind { kVoice, kStream };
+
+// One voice or Go Live connection
+// It owns a UDP socket and its receive pipeline but no thread, reads are
+// queued on the shared pool by the poller whenever the socket has data
+class Connection {
+ public:
+  // recorder may be nullptr, otherwise it has to outlive the connection
+  Connection(ConnectionKind kind, SocketPoller& poller, RtpRecorder* recorder);
+
+  ~Connection();
+
+  Connection(const Connection&) = delete;
+  Connection& operator=(const Connection&) = delete;
+
+  // Payload types tick at the connection's default rate unless given one
+  // of their own here, has to happen before Connect
+  void SetClockRate(uint8_t payloadType, uint32_t clockRate);
+
+  // Opens the socket and starts receiving from address (numeric IPv4 or
+  // IPv6) and port
+  // Returns 0 on success or a negative errno
+  int Connect(const std::string& address, uint16_t port);
+
+  // Stops receiving, safe to call more than once
+  void Close();
+
+  ConnectionKind Kind() const { return kind_; }
+
+  // The address and port we're sending from
+  bool LocalAddress(std::string& address, uint16_t& port) const;
+
+  std::vector<rtp_stream_stats> Stats();
+
+ private:
+  static void OnReadable(int fd, void* data);
+
+  // Datagrams fetched per recvmmsg call
+  static constexpr size_t kBatchSize{16};
+  // Larger than any packet that fits the path MTU
+  static constexpr size_t kMaxPacketSize{2048};
+  // Room for the SCM_TIMESTAMPNS message carrying the arrival time
+  static constexpr size_t kControlSize{CMSG_SPACE(sizeof(timespec))};
+
+  ConnectionKind kind_;
+  SocketPoller& poller_;
+  socket_handler handler_;
+  int fd_{-1};
+
+  // Guards the receiver and the packet buffers between the read handler
+  // on the pool and Stats on the JavaScript thread
+  std::mutex receiverMutex_;
+  RtpReceiver receiver_;
+  std::array<std::array<uint8_t, kMaxPacketSize>, kBatchSize> packets_;
+  struct alignas(cmsghdr) control_buffer {
+    uint8_t data[kControlSize];
+  };
+  std::array<control_buffer, kBatchSize> controls_;
+};
@@ -0,0 +1,53 @@
+#include "rtp_packet.h"
+
+constexpr size_t kFixedHeaderSize{12};
+
+static uint16_t ReadUint16(const uint8_t* data) {
+  return static_cast<uint16_t>(data[0] << 8 | data[1]);
+}
+
+static uint32_t ReadUint32(const uint8_t* data) {
+  return static_cast<uint32_t>(data[0]) << 24 |
+         static_cast<uint32_t>(data[1]) << 16 |
+         static_cast<uint32_t>(data[2]) << 8 | data[3];
+}
+
+bool ParseRtpHeader(const uint8_t* packet, size_t size, rtp_header& header) {
+  if (size < kFixedHeaderSize || packet[0] >> 6 != 2) {
+    return false;
+  }
+
+  bool padding = packet[0] & 0x20;
+  bool extension = packet[0] & 0x10;
+  size_t csrcCount = packet[0] & 0x0f;
+
+  header.marker = packet[1] & 0x80;
+  header.payloadType = packet[1] & 0x7f;
+  header.sequence = ReadUint16(packet + 2);
+  header.timestamp = ReadUint32(packet + 4);
+  header.ssrc = ReadUint32(packet + 8);
+
+  size_t offset = kFixedHeaderSize + csrcCount * 4;
+  if (extension) {
+    if (size < offset + 4) {
+      return false;
+    }
+    offset += 4 + ReadUint16(packet + offset + 2) * size_t{4};
+  }
+  if (size < offset) {
+    return false;
+  }
+
+  size_t end = size;
+  if (padding) {
+    size_t paddingSize = packet[size - 1];
+    if (paddingSize == 0 || end - offset < paddingSize) {
+      return false;
+    }
+    end -= paddingSize;
+  }
+
+  header.payloadOffset = offset;
+  header.payloadSize = end - offset;
+  return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// The fixed RTP header (RFC 3550) plus where the payload sits,
+// CSRCs, the header extension and padding are skipped over
+struct rtp_header {
+  uint8_t payloadType;
+  bool marker;
+  uint16_t sequence;
+  uint32_t timestamp;
+  uint32_t ssrc;
+  size_t payloadOffset;
+  size_t payloadSize;
+};
+
+// Returns false if the packet isn't a well formed RTP version 2 packet
+bool ParseRtpHeader(const uint8_t* packet, size_t size, rtp_header& header);
@@ -0,0 +1,92 @@
+#include "rtp_receiver.h"
+
+#include <cmath>
+
+RtpReceiver::RtpReceiver(uint32_t clockRate) {
+  clockRates_.fill(clockRate);
+}
+
+void RtpReceiver::SetClockRate(uint8_t payloadType, uint32_t clockRate) {
+  if (payloadType < clockRates_.size()) {
+    clockRates_[payloadType] = clockRate;
+  }
+}
+
+void RtpReceiver::SetRecorder(RtpRecorder* recorder) {
+  recorder_.store(recorder, std::memory_order_release);
+}
+
+void RtpReceiver::SetPayloadHandler(rtp_payload_handler* handler) {
+  handler_.store(handler, std::memory_order_release);
+}
+
+void RtpReceiver::Receive(const uint8_t* packet,
+                          size_t size,
+                          uint64_t arrivalNs) {
+  RtpRecorder* recorder = recorder_.load(std::memory_order_acquire);
+  if (recorder) {
+    recorder->Record(packet, size, arrivalNs);
+  }
+
+  rtp_header header;
+  if (!ParseRtpHeader(packet, size, header)) {
+    invalid_++;
+    return;
+  }
+
+  auto [entry, added] = streams_.try_emplace(header.ssrc);
+  stream_state& stream = entry->second;
+  if (added) {
+    stream.stats.ssrc = header.ssrc;
+    stream.stats.clockRate = clockRates_[header.payloadType];
+    stream.nsToTimestamp = stream.stats.clockRate / 1e9;
+  }
+
+  // Transit time in timestamp units, only its changes matter so the
+  // unrelated clock origins cancel out
+  int64_t transit = std::llround(arrivalNs * stream.nsToTimestamp) -
+                    static_cast<int64_t>(header.timestamp);
+
+  if (added) {
+    stream.firstSequence = header.sequence;
+    stream.highestSequence = header.sequence;
+    stream.lastTransit = transit;
+  } else {
+    // Pick the wrap count that puts the sequence closest to the highest one
+    int16_t delta = static_cast<int16_t>(
+        header.sequence - static_cast<uint16_t>(stream.highestSequence));
+    uint64_t sequence = stream.highestSequence + delta;
+    if (delta > 0) {
+      stream.highestSequence = sequence;
+    } else {
+      stream.stats.reordered++;
+    }
+
+    // The timestamp wraps too, but only the difference is used
+    int64_t difference = static_cast<int32_t>(
+        static_cast<uint32_t>(transit - stream.lastTransit));
+    stream.lastTransit = transit;
+    stream.stats.jitter +=
+        (std::abs(static_cast<double>(difference)) - stream.stats.jitter) / 16;
+  }
+
+  stream.stats.packets++;
+  stream.stats.payloadBytes += header.payloadSize;
+  stream.stats.lost =
+      static_cast<int64_t>(stream.highestSequence - stream.firstSequence + 1) -
+      static_cast<int64_t>(stream.stats.packets);
+
+  rtp_payload_handler* handler = handler_.load(std::memory_order_acquire);
+  if (handler) {
+    (*(handler->handler))(header, packet + header.payloadOffset, handler->data);
+  }
+}
+
+std::vector<rtp_stream_stats> RtpReceiver::Stats() const {
+  std::vector<rtp_stream_stats> stats;
+  stats.reserve(streams_.size());
+  for (const auto& [ssrc, stream] : streams_) {
+    stats.push_back(stream.stats);
+  }
+  return stats;
+}
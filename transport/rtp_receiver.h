@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "rtp_packet.h"
+#include "rtp_recording.h"
+
+// Called for every valid packet once it went through the receiver,
+// this is where the jitter buffer and the decoders hang off
+struct rtp_payload_handler {
+  void (*handler)(const rtp_header& header,
+                  const uint8_t* payload,
+                  void* data);
+  void* data;
+};
+
+// Per SSRC receive statistics as defined by RFC 3550
+struct rtp_stream_stats {
+  uint32_t ssrc;
+  uint64_t packets;
+  uint64_t payloadBytes;
+  // Expected minus received, duplicates can push it below zero
+  int64_t lost;
+  // Packets older than one already seen
+  uint64_t reordered;
+  // RTP timestamp rate of the stream's payload type
+  uint32_t clockRate;
+  // Interarrival jitter in timestamp units
+  double jitter;
+};
+
+// The entry point of the receive pipeline, the transport hands it every
+// datagram it reads and so does the replay driver
+// Everything but SetRecorder and SetPayloadHandler has to be called from
+// one thread
+class RtpReceiver {
+ public:
+  // clockRate is the RTP timestamp rate of payload types that weren't
+  // given one of their own
+  explicit RtpReceiver(uint32_t clockRate);
+
+  // Audio and video streams tick at different rates, 48 kHz for Opus and
+  // 90 kHz for video, a stream keeps the rate of the first packet it sent
+  void SetClockRate(uint8_t payloadType, uint32_t clockRate);
+
+  // Packets are recorded as they arrive, before any validation,
+  // nullptr stops recording
+  void SetRecorder(RtpRecorder* recorder);
+
+  void SetPayloadHandler(rtp_payload_handler* handler);
+
+  // arrivalNs is a steady clock reading taken when the packet arrived
+  void Receive(const uint8_t* packet, size_t size, uint64_t arrivalNs);
+
+  // Packets that weren't RTP at all
+  uint64_t Invalid() const { return invalid_; }
+
+  std::vector<rtp_stream_stats> Stats() const;
+
+ private:
+  struct stream_state {
+    rtp_stream_stats stats;
+    // Sequence numbers extended with a wrap count
+    uint64_t firstSequence;
+    uint64_t highestSequence;
+    int64_t lastTransit;
+    double nsToTimestamp;
+  };
+
+  std::array<uint32_t, 128> clockRates_;
+  std::atomic<RtpRecorder*> recorder_{nullptr};
+  std::atomic<rtp_payload_handler*> handler_{nullptr};
+  std::unordered_map<uint32_t, stream_state> streams_;
+  uint64_t invalid_{};
+};
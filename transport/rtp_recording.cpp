@@ -0,0 +1,262 @@
+#include "rtp_recording.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <limits>
+
+constexpr char kRecordingMagic[8]{'O', 'V', 'R', 'T', 'P', 'R', 'E', 'C'};
+constexpr uint32_t kRecordingVersion{1};
+constexpr size_t kRecordAlignment{8};
+// Buffered bytes that wake the writer
+constexpr size_t kFlushSize{64 * 1024};
+// Buffered bytes at which the recording stops because the disk can't keep
+// up, both buffers are reserved this big so Record never allocates
+constexpr size_t kMaxBuffered{4 * 1024 * 1024};
+
+static size_t AlignRecord(size_t size) {
+  return (size + kRecordAlignment - 1) & ~(kRecordAlignment - 1);
+}
+
+static int WriteAll(int fd, const uint8_t* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -errno;
+    }
+    data += written;
+    size -= written;
+  }
+  return 0;
+}
+
+RtpRecorder::~RtpRecorder() {
+  Close();
+}
+
+int RtpRecorder::Open(const std::string& path) {
+  std::scoped_lock control{controlMutex_};
+  CloseLocked();
+
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return -errno;
+  }
+
+  timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  timespec steadyNow;
+  clock_gettime(CLOCK_MONOTONIC, &steadyNow);
+
+  rtp_recording_header header{};
+  std::memcpy(header.magic, kRecordingMagic, sizeof(header.magic));
+  header.version = kRecordingVersion;
+  header.headerSize = sizeof(header);
+  header.startTimeNs = now.tv_sec * uint64_t{1000000000} + now.tv_nsec;
+
+  int result =
+      WriteAll(fd, reinterpret_cast<uint8_t*>(&header), sizeof(header));
+  if (result < 0) {
+    close(fd);
+    return result;
+  }
+
+  buffer_.reserve(kMaxBuffered);
+  written_.reserve(kMaxBuffered);
+  fd_ = fd;
+  {
+    std::scoped_lock lock{mutex_};
+    recording_ = true;
+    closing_ = false;
+    originNs_ = steadyNow.tv_sec * uint64_t{1000000000} + steadyNow.tv_nsec;
+  }
+  writer_ = std::thread{&RtpRecorder::Write, this};
+  return 0;
+}
+
+void RtpRecorder::Close() {
+  std::scoped_lock control{controlMutex_};
+  CloseLocked();
+}
+
+bool RtpRecorder::Recording() {
+  std::scoped_lock lock{mutex_};
+  return recording_;
+}
+
+void RtpRecorder::Record(const uint8_t* packet,
+                         size_t size,
+                         uint64_t arrivalNs) {
+  std::scoped_lock lock{mutex_};
+  if (!recording_ || size == 0 ||
+      size > std::numeric_limits<uint16_t>::max()) {
+    return;
+  }
+
+  size_t before = buffer_.size();
+  size_t after = AlignRecord(before + sizeof(rtp_record_header) + size);
+  if (after > kMaxBuffered) {
+    // Rather stop recording than leave a gap in the middle of it
+    fprintf(stderr, "rtp recording: writing fell behind, stopped\n");
+    recording_ = false;
+    return;
+  }
+
+  rtp_record_header header{};
+  // Packets can be stamped by the kernel just before the recording started
+  header.arrivalNs = arrivalNs > originNs_ ? arrivalNs - originNs_ : 0;
+  header.size = static_cast<uint16_t>(size);
+  if (size >= 12) {
+    header.ssrc = static_cast<uint32_t>(packet[8]) << 24 |
+                  static_cast<uint32_t>(packet[9]) << 16 |
+                  static_cast<uint32_t>(packet[10]) << 8 | packet[11];
+  }
+
+  auto* headerBytes = reinterpret_cast<const uint8_t*>(&header);
+  buffer_.insert(buffer_.end(), headerBytes, headerBytes + sizeof(header));
+  buffer_.insert(buffer_.end(), packet, packet + size);
+  buffer_.resize(after);
+
+  if (before < kFlushSize && after >= kFlushSize) {
+    flush_.notify_one();
+  }
+}
+
+// Runs on the writer thread until Close
+void RtpRecorder::Write() {
+  std::unique_lock lock{mutex_};
+  while (true) {
+    flush_.wait(lock,
+                [this] { return closing_ || buffer_.size() >= kFlushSize; });
+    if (buffer_.empty()) {
+      return;
+    }
+
+    buffer_.swap(written_);
+    lock.unlock();
+    int result = WriteAll(fd_, written_.data(), written_.size());
+    written_.clear();
+    lock.lock();
+
+    if (result < 0) {
+      fprintf(stderr, "rtp recording: %s\n", strerror(-result));
+      recording_ = false;
+      buffer_.clear();
+      return;
+    }
+  }
+}
+
+// Called with controlMutex_ held
+void RtpRecorder::CloseLocked() {
+  if (!writer_.joinable()) {
+    return;
+  }
+
+  {
+    std::scoped_lock lock{mutex_};
+    recording_ = false;
+    closing_ = true;
+  }
+  flush_.notify_one();
+  writer_.join();
+
+  close(fd_);
+  fd_ = -1;
+  buffer_.clear();
+  buffer_.shrink_to_fit();
+  written_.shrink_to_fit();
+}
+
+RtpRecording::~RtpRecording() {
+  Close();
+}
+
+int RtpRecording::Open(const std::string& path) {
+  Close();
+
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return -errno;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    int result = -errno;
+    close(fd);
+    return result;
+  }
+
+  size_t size = st.st_size;
+  if (size < sizeof(rtp_recording_header)) {
+    close(fd);
+    return -EINVAL;
+  }
+
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  int result = data == MAP_FAILED ? -errno : 0;
+  close(fd);
+  if (result < 0) {
+    return result;
+  }
+
+  const auto* header = static_cast<const rtp_recording_header*>(data);
+  if (std::memcmp(header->magic, kRecordingMagic, sizeof(header->magic)) ||
+      header->version != kRecordingVersion ||
+      header->headerSize < sizeof(rtp_recording_header) ||
+      header->headerSize > size || header->headerSize % kRecordAlignment) {
+    munmap(data, size);
+    return -EINVAL;
+  }
+
+  madvise(data, size, MADV_SEQUENTIAL);
+  data_ = static_cast<const uint8_t*>(data);
+  size_ = size;
+  cursor_ = header->headerSize;
+  return 0;
+}
+
+void RtpRecording::Close() {
+  if (data_) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  cursor_ = 0;
+}
+
+bool RtpRecording::Next(rtp_record& record) {
+  if (!data_ || size_ - cursor_ < sizeof(rtp_record_header)) {
+    return false;
+  }
+
+  const auto* header =
+      reinterpret_cast<const rtp_record_header*>(data_ + cursor_);
+  size_t packetOffset = cursor_ + sizeof(rtp_record_header);
+  if (size_ - packetOffset < header->size) {
+    return false;
+  }
+
+  record.arrivalNs = header->arrivalNs;
+  record.ssrc = header->ssrc;
+  record.packet = data_ + packetOffset;
+  record.size = header->size;
+  cursor_ = std::min(AlignRecord(packetOffset + header->size), size_);
+  return true;
+}
+
+void RtpRecording::Rewind() {
+  if (data_) {
+    cursor_ = reinterpret_cast<const rtp_recording_header*>(data_)->headerSize;
+  }
+}
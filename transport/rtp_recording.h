@@ -0,0 +1,111 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Recordings are a 32 byte file header followed by one record per packet
+// Every record is a 16 byte record header followed by the whole RTP packet
+// as it came off the wire, padded so the next record is 8 byte aligned
+// Records are in the order they were written, not strictly arrival order
+// Everything is in host byte order except the packets themselves, so a
+// mapped recording can be walked in place without copying or parsing
+struct rtp_recording_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  // CLOCK_REALTIME when the recording started, for reference only
+  uint64_t startTimeNs;
+  uint64_t reserved;
+};
+
+struct rtp_record_header {
+  // Arrival time relative to the start of the recording
+  uint64_t arrivalNs;
+  // Copied from the packet so streams can be picked without parsing it
+  uint32_t ssrc;
+  uint16_t size;
+  uint16_t reserved;
+};
+
+static_assert(sizeof(rtp_recording_header) == 32);
+static_assert(sizeof(rtp_record_header) == 16);
+
+// A packet read back from a recording, packet points into the mapping
+struct rtp_record {
+  uint64_t arrivalNs;
+  uint32_t ssrc;
+  const uint8_t* packet;
+  size_t size;
+};
+
+// Appends received packets to a recording
+// Record is called on the receive path and only copies the packet into a
+// buffer, a writer thread of the recording's own swaps the buffer out
+// once it's full and writes it, so a slow disk never holds up receiving
+class RtpRecorder {
+ public:
+  ~RtpRecorder();
+
+  // Replaces any recording in progress
+  // Returns 0 on success or a negative errno
+  int Open(const std::string& path);
+
+  // Writes out whatever is still buffered
+  void Close();
+
+  bool Recording();
+
+  // arrivalNs is a steady clock reading taken when the packet arrived
+  void Record(const uint8_t* packet, size_t size, uint64_t arrivalNs);
+
+ private:
+  void Write();
+  void CloseLocked();
+
+  // Serializes Open and Close
+  std::mutex controlMutex_;
+  // Guards what Record shares with the writer, held only for a copy
+  std::mutex mutex_;
+  std::condition_variable flush_;
+  bool recording_{};
+  bool closing_{};
+  // Steady clock reading when the recording started
+  uint64_t originNs_{};
+  std::vector<uint8_t> buffer_;
+  // Owned by the writer while it runs
+  int fd_{-1};
+  std::vector<uint8_t> written_;
+  std::thread writer_;
+};
+
+// A recording mapped into memory for replay
+class RtpRecording {
+ public:
+  ~RtpRecording();
+
+  // Returns 0 on success or a negative errno, -EINVAL if it isn't a
+  // recording
+  int Open(const std::string& path);
+
+  void Close();
+
+  // Walks the records in the order they were written, returns false at
+  // the end
+  // That's arrival order within a connection, but connections are read on
+  // different workers, so a record can come after a later arrival from
+  // another connection
+  // A record cut short by a crash while recording ends the walk
+  bool Next(rtp_record& record);
+
+  void Rewind();
+
+ private:
+  const uint8_t* data_{};
+  size_t size_{};
+  size_t cursor_{};
+};
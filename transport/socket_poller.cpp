@@ -0,0 +1,170 @@
+#include "socket_poller.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+
+constexpr int kMaxEvents{64};
+
+SocketPoller::SocketPoller(WorkPool& pool)
+    : pool_{pool},
+      epollFd_{epoll_create1(EPOLL_CLOEXEC)},
+      wakeFd_{eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)} {
+  if (epollFd_ < 0 || wakeFd_ < 0) {
+    perror("socket poller");
+    return;
+  }
+
+  // The wake eventfd is told apart from sockets by its null data
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.ptr = nullptr;
+  epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &event);
+
+  thread_ = std::thread{&SocketPoller::Run, this};
+}
+
+SocketPoller::~SocketPoller() {
+  if (thread_.joinable()) {
+    {
+      std::scoped_lock lock{mutex_};
+      stopping_ = true;
+    }
+    Wake();
+    thread_.join();
+  }
+
+  if (epollFd_ >= 0) close(epollFd_);
+  if (wakeFd_ >= 0) close(wakeFd_);
+}
+
+int SocketPoller::Add(int fd, socket_handler* handler) {
+  if (!thread_.joinable()) {
+    return -EBADF;
+  }
+
+  auto added = std::make_unique<watch>();
+  added->poller = this;
+  added->fd = fd;
+  added->handler = handler;
+  added->pending = 0;
+
+  std::scoped_lock lock{mutex_};
+  epoll_event event{};
+  event.events = EPOLLIN | EPOLLONESHOT;
+  event.data.ptr = added.get();
+  if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+    return -errno;
+  }
+
+  watches_[fd] = std::move(added);
+  return 0;
+}
+
+void SocketPoller::Remove(int fd) {
+  std::unique_lock lock{mutex_};
+  auto entry = watches_.find(fd);
+  if (entry == watches_.end()) {
+    return;
+  }
+  watch* removed = entry->second.get();
+
+  removals_.push_back(fd);
+  Wake();
+  removed_.wait(lock, [this, fd] {
+    return std::find(removals_.begin(), removals_.end(), fd) ==
+           removals_.end();
+  });
+
+  // A handler still draining the socket can take a while, the poller and
+  // every other socket carry on meanwhile
+  lock.unlock();
+  {
+    std::unique_lock watchLock{removed->mutex};
+    removed->idle.wait(watchLock,
+                       [removed] { return removed->pending == 0; });
+  }
+
+  lock.lock();
+  watches_.erase(fd);
+}
+
+void SocketPoller::Wake() {
+  uint64_t one{1};
+  if (write(wakeFd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+    perror("socket poller wake");
+  }
+}
+
+void SocketPoller::RunWatch(void* data) {
+  auto* current = static_cast<watch*>(data);
+  socket_handler* sh = current->handler;
+  (*(sh->handler))(current->fd, sh->data);
+
+  // Fails harmlessly if the socket was removed in the meantime
+  epoll_event event{};
+  event.events = EPOLLIN | EPOLLONESHOT;
+  event.data.ptr = current;
+  epoll_ctl(current->poller->epollFd_, EPOLL_CTL_MOD, current->fd, &event);
+
+  std::scoped_lock lock{current->mutex};
+  if (--current->pending == 0) {
+    current->idle.notify_all();
+  }
+}
+
+void SocketPoller::Run() {
+  epoll_event events[kMaxEvents];
+
+  while (true) {
+    int count = epoll_wait(epollFd_, events, kMaxEvents, -1);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("epoll_wait");
+      return;
+    }
+
+    bool woken{};
+    for (int i{}; i < count; i++) {
+      auto* ready = static_cast<watch*>(events[i].data.ptr);
+      if (!ready) {
+        woken = true;
+        continue;
+      }
+
+      {
+        std::scoped_lock lock{ready->mutex};
+        ready->pending++;
+      }
+      pool_.Submit({RunWatch, ready});
+    }
+
+    if (!woken) {
+      continue;
+    }
+
+    uint64_t value;
+    while (read(wakeFd_, &value, sizeof(value)) > 0) {
+    }
+
+    // Every event fetched above has been handed out, so after the
+    // EPOLL_CTL_DEL nothing but an already queued handler refers to a watch
+    std::scoped_lock lock{mutex_};
+    for (int fd : removals_) {
+      epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, nullptr);
+    }
+    removals_.clear();
+    removed_.notify_all();
+
+    if (stopping_) {
+      return;
+    }
+  }
+}
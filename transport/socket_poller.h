@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "work_pool.h"
+
+// Called on the pool whenever the socket is readable
+// The handler has to read until EAGAIN, the socket isn't watched again
+// before it returns so the same socket is never handled twice at once
+struct socket_handler {
+  void (*handler)(int fd, void* data);
+  void* data;
+};
+
+// A single thread waits on the sockets of every connection and queues
+// their reads on the pool, so waiting for the network doesn't cost a
+// thread per connection either
+class SocketPoller {
+ public:
+  explicit SocketPoller(WorkPool& pool);
+
+  ~SocketPoller();
+
+  // fd has to be non-blocking
+  // Returns 0 on success or a negative errno
+  int Add(int fd, socket_handler* handler);
+
+  // Once this returns the handler is neither queued nor running
+  // and won't be called again
+  void Remove(int fd);
+
+ private:
+  struct watch {
+    SocketPoller* poller;
+    int fd;
+    socket_handler* handler;
+    std::mutex mutex;
+    std::condition_variable idle;
+    // Handler calls queued or running, a rearmed socket can fire again
+    // before the call that rearmed it has quite finished
+    int pending;
+  };
+
+  static void RunWatch(void* data);
+  void Run();
+  void Wake();
+
+  WorkPool& pool_;
+  int epollFd_;
+  int wakeFd_;
+  std::thread thread_;
+
+  std::mutex mutex_;
+  std::condition_variable removed_;
+  std::unordered_map<int, std::unique_ptr<watch>> watches_;
+  // Removals are carried out by the polling thread, so an event it
+  // already fetched for a socket can't outlive the socket's watch
+  std::vector<int> removals_;
+  bool stopping_{};
+};
@@ -0,0 +1,105 @@
+#include "work_pool.h"
+
+#include <algorithm>
+
+// Which pool and queue the calling thread works for, if any
+static thread_local WorkPool* current_pool{nullptr};
+static thread_local size_t current_queue{};
+
+WorkPool::WorkPool(size_t workers) {
+  if (workers == 0) {
+    workers = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+
+  for (size_t i{}; i < workers; i++) {
+    queues_.push_back(std::make_unique<worker_queue>());
+  }
+  for (size_t i{}; i < workers; i++) {
+    threads_.emplace_back(&WorkPool::Run, this, i);
+  }
+}
+
+WorkPool::~WorkPool() {
+  {
+    std::scoped_lock lock{sleepMutex_};
+    stopping_ = true;
+  }
+  wake_.notify_all();
+
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void WorkPool::Submit(work_item item) {
+  size_t index = current_pool == this
+                     ? current_queue
+                     : nextQueue_.fetch_add(1, std::memory_order_relaxed) %
+                           queues_.size();
+
+  // Counted before it's visible so the count never drops below zero
+  queued_.fetch_add(1, std::memory_order_release);
+  {
+    std::scoped_lock lock{queues_[index]->mutex};
+    queues_[index]->items.push_back(item);
+  }
+
+  // Taking the lock orders this against a worker that is about to sleep,
+  // so it either sees the new work or gets the notification
+  {
+    std::scoped_lock lock{sleepMutex_};
+  }
+  wake_.notify_one();
+}
+
+// Own queue from the back, everyone else's from the front
+bool WorkPool::Take(size_t index, work_item& item) {
+  {
+    worker_queue& own = *queues_[index];
+    std::scoped_lock lock{own.mutex};
+    if (!own.items.empty()) {
+      item = own.items.back();
+      own.items.pop_back();
+      return true;
+    }
+  }
+
+  for (size_t i{1}; i < queues_.size(); i++) {
+    worker_queue& victim = *queues_[(index + i) % queues_.size()];
+    std::scoped_lock lock{victim.mutex};
+    if (!victim.items.empty()) {
+      item = victim.items.front();
+      victim.items.pop_front();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void WorkPool::Run(size_t index) {
+  current_pool = this;
+  current_queue = index;
+
+  while (true) {
+    work_item item;
+    if (Take(index, item)) {
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      (*(item.run))(item.data);
+      continue;
+    }
+
+    std::unique_lock lock{sleepMutex_};
+    // Queued work we couldn't find is being taken by someone else
+    // right now, so spinning on it once more is cheap
+    if (queued_.load(std::memory_order_acquire) > 0) {
+      continue;
+    }
+    if (stopping_) {
+      return;
+    }
+    wake_.wait(lock, [this] {
+      return stopping_ || queued_.load(std::memory_order_acquire) > 0;
+    });
+  }
+}
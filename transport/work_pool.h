@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct work_item {
+  void (*run)(void* data);
+  void* data;
+};
+
+// Fixed set of worker threads shared by every connection, so the thread
+// count follows the core count instead of the number of connections
+// Each worker has its own queue, work submitted from a worker stays on it
+// and is taken newest first while it's still warm in the cache, idle
+// workers steal the oldest work from the others so a busy connection
+// spreads over every core
+class WorkPool {
+ public:
+  // workers of 0 means one per core
+  explicit WorkPool(size_t workers);
+
+  // Runs whatever is still queued, then joins the workers
+  ~WorkPool();
+
+  // Safe to call from any thread, including from inside a work item
+  void Submit(work_item item);
+
+  size_t Workers() const { return queues_.size(); }
+
+ private:
+  struct worker_queue {
+    std::mutex mutex;
+    std::deque<work_item> items;
+  };
+
+  void Run(size_t index);
+  bool Take(size_t index, work_item& item);
+
+  std::vector<std::unique_ptr<worker_queue>> queues_;
+  std::vector<std::thread> threads_;
+  // Work queued anywhere, workers only sleep while it's zero
+  std::atomic<size_t> queued_{0};
+  // Spreads submissions from outside the pool over the workers
+  std::atomic<size_t> nextQueue_{0};
+  std::mutex sleepMutex_;
+  std::condition_variable wake_;
+  bool stopping_{};
+};